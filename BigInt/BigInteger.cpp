@@ -1,15 +1,26 @@
 ﻿#include "BigInteger.h"
+#include "LimbKernels.h"
+#include "SlidingWindowPow.h"
+
+#include <array>
+#include <numeric>
 
 const int BigInteger::STEP[] = { 4, 2, 4, 2, 4, 6, 2, 6, };
 const int BigInteger::STEP_COUNT = sizeof(BigInteger::STEP) / sizeof(BigInteger::STEP[0]);
 const int64_t BigInteger::BASE = 10'0000'0000LL;
 const int BigInteger::DIGIT_WIDTH = 9;
+const size_t BigInteger::TOOM3_THRESHOLD = 160;
+const size_t BigInteger::NTT_THRESHOLD = 2000;
+const size_t BigInteger::NTT_SQR_THRESHOLD = 1600;
+const size_t BigInteger::BURNIKEL_ZIEGLER_THRESHOLD = 160;
+const size_t BigInteger::BURNIKEL_ZIEGLER_OFFSET = 80;
+const size_t BigInteger::GCD_HALF_THRESHOLD = 100;
+const size_t BigInteger::TRIAL_DIVISION_BATCH = 256;
+const size_t BigInteger::TRIAL_DIVISION_CHUNK = 64 * BigInteger::TRIAL_DIVISION_BATCH;
 
 bool isNegative = false;
 
-uint32_t* BigInteger::sPrimes = nullptr;
-size_t BigInteger::primeCount = 0;
-MemoryMapFile BigInteger::sMemFile;
+PrimeTable BigInteger::sPrimeTable;
 
 
 BigInteger::BigInteger(uint64_t num) : isNegative(false) {
@@ -48,6 +59,12 @@ bool BigInteger::isZero() const {
 	return digits.empty() || (digits.size() == 1 && digits[0] == 0);
 }
 
+void BigInteger::negate() {
+	if (!isZero()) {
+		isNegative = !isNegative;
+	}
+}
+
 void BigInteger::removeLeadingZeros() {
 	while (digits.size() > 1 && digits.back() == 0) {
 		digits.pop_back();
@@ -57,14 +74,35 @@ void BigInteger::removeLeadingZeros() {
 	}
 }
 
-int32_t BigInteger::mod3() const {
-	int32_t sum = 0;
-	for (int32_t digit : digits) {
-		sum += digit;
-		sum %= 3;  // 累加过程中对 3 取模，避免溢出
+BigInteger BigInteger::slice(size_t from, size_t count) const {
+	Digits part;
+	if (from < digits.size()) {
+		part.assign(digits.begin() + from, digits.begin() + std::min(digits.size(), from + count));
+	}
+	if (part.empty()) {
+		part.push_back(0);
+	}
+
+	return BigInteger(std::move(part), false);
+}
+
+BigInteger BigInteger::shiftedLeft(size_t count) const {
+	BigInteger result = *this;
+	if (!isZero()) {
+		result.digits.insert(result.digits.begin(), count, 0);
 	}
 
-	return sum % 3;
+	return result;
+}
+
+uint32_t BigInteger::divSmallInPlace(uint32_t d) {
+	uint32_t remainder = limb::divSmall(digits.data(), digits.size(), d);
+	removeLeadingZeros();
+	return remainder;
+}
+
+int32_t BigInteger::mod3() const {
+	return static_cast<int32_t>(limb::modSmall(digits.data(), digits.size(), 3));
 }
 
 auto BigInteger::compareDigits(const BigInteger& other) const {
@@ -83,103 +121,344 @@ auto BigInteger::compareDigits(const BigInteger& other) const {
 	return std::strong_ordering::equal;
 }
 
-bool BigInteger::checkPrimeWithStep(BigInteger& divisor, BigInteger start) const {
-	int stepIndex = 0;
-	BigInteger x = start;
+namespace {
+
+// 把编号 [0, chunks) 的段分给 threads 个线程（含调用线程），各线程按编号从小到大领取，
+// scan(k, found) 返回第 k 段中的第一个因子，没有时返回 0。找到因子后不再领取编号更大的段，
+// 正在试除的段通过 found 得知后提前退出；编号更小的段照常完成，所以返回的总是最小的因子
+template <typename Scan>
+uint32_t parallelFirstDivisor(size_t chunks, unsigned threads, Scan scan) {
+	std::atomic<size_t> next{ 0 };
+	std::atomic<size_t> found{ std::numeric_limits<size_t>::max() };
+	std::vector<uint32_t> divisors(chunks, 0);
+	auto worker = [&] {
+		while (true) {
+			const size_t k = next.fetch_add(1);
+			if (k >= chunks || k > found.load()) {
+				return;
+			}
+			const uint32_t d = scan(k, std::as_const(found));
+			if (d != 0) {
+				divisors[k] = d;
+				size_t current = found.load();
+				while (k < current && !found.compare_exchange_weak(current, k)) {
+				}
+			}
+		}
+	};
 
-	while (true) {
-		// 一次性计算商和余数
-		auto [quotient, remainder] = this->innerDiv(x);
+	std::vector<std::thread> pool;
+	for (unsigned i = 1; i < threads && i < chunks; ++i) {
+		try {
+			pool.emplace_back(worker);
+		}
+		catch (const std::system_error&) {
+			// 无法创建更多线程时由已有的线程完成
+			break;
+		}
+	}
+	worker();
+	for (std::thread& t : pool) {
+		t.join();
+	}
 
-		// 检查整除性
-		if (remainder == 0) {
-			divisor = x;
-			return false;
+	const size_t k = found.load();
+	return k < chunks ? divisors[k] : 0;
+}
+
+} // namespace
+
+bool BigInteger::loadPrimeTable() {
+	// 局部静态变量的初始化只执行一次，多个线程同时首次调用时其余线程等待加载完成
+	static const bool loaded = sPrimeTable.load(USTR("primes.dat"));
+	return loaded;
+}
+
+int BigInteger::wheelStepIndex(uint32_t value) {
+	int v = (value - 7) % 30;
+	int step_index = 0;
+	while (v > 0) {
+		v -= STEP[step_index];
+		++step_index;
+		step_index %= STEP_COUNT;
+	}
+	return step_index;
+}
+
+BigInteger::TrialResult BigInteger::checkPrimeWithStep(BigInteger& divisor, uint64_t start, int stepIndex, uint64_t limit, uint64_t root, unsigned threads) const {
+	uint64_t x = start;
+
+	// 32 位以内的候选数按批试除
+	const uint64_t batchLimit = std::min<uint64_t>(limit, std::numeric_limits<uint32_t>::max());
+	const uint64_t span = 30 * (TRIAL_DIVISION_CHUNK / STEP_COUNT);
+	if (threads > 1 && root > std::numeric_limits<uint32_t>::max() && x + 2 * span <= batchLimit) {
+		// 每段覆盖 span 个连续整数，span 是 30 的倍数，所以各段起点在轮上的位置都与 start 相同
+		const size_t chunks = (batchLimit - x) / span + 1;
+		const uint32_t p = parallelFirstDivisor(chunks, threads, [&](size_t k, const std::atomic<size_t>& found) {
+			uint64_t y = x + k * span;
+			const uint64_t end = std::min(y + span - 1, batchLimit);
+			int index = stepIndex;
+			uint32_t candidates[TRIAL_DIVISION_BATCH];
+			while (y <= end) {
+				size_t count = 0;
+				while (count < TRIAL_DIVISION_BATCH && y <= end) {
+					candidates[count++] = static_cast<uint32_t>(y);
+					y += STEP[index];
+					++index;
+					index %= STEP_COUNT;
+				}
+				const uint32_t d = firstDivisor(candidates, count, k, found);
+				if (d != 0) {
+					return d;
+				}
+			}
+			return uint32_t(0);
+		});
+		if (p != 0) {
+			divisor = p;
+			return TrialResult::Divisible;
 		}
 
-		// 提前终止条件：如果商小于等于当前除数，后续不可能整除
-		if (quotient <= x) {
-			break;
+		// 从最后一段的起点走到 batchLimit 之后的第一个候选数
+		x += (chunks - 1) * span;
+		while (x <= batchLimit) {
+			x += STEP[stepIndex];
+			++stepIndex;
+			stepIndex %= STEP_COUNT;
+		}
+	}
+
+	uint32_t candidates[TRIAL_DIVISION_BATCH];
+	while (x <= batchLimit) {
+		size_t count = 0;
+		while (count < TRIAL_DIVISION_BATCH && x <= batchLimit) {
+			candidates[count++] = static_cast<uint32_t>(x);
+			x += STEP[stepIndex];
+			++stepIndex;
+			stepIndex %= STEP_COUNT;
+		}
+
+		const TrialResult result = trialDivide(candidates, count, divisor, root);
+		if (result != TrialResult::Undecided) {
+			return result;
+		}
+	}
+
+	while (x <= limit) {
+		// 超过平方根后不可能整除，只需比较，不必计算商
+		if (x > root) {
+			return TrialResult::Prime;
+		}
+		if ((*this % x).isZero()) {
+			divisor = x;
+			return TrialResult::Divisible;
 		}
 
-		x = BigInteger(STEP[stepIndex]) + x;
+		x += STEP[stepIndex];
 		++stepIndex;
 		stepIndex %= STEP_COUNT;
 	}
 
-	return true;
+	return TrialResult::Undecided;
 }
 
-BigInteger BigInteger::innerAdd(const BigInteger& other) const {
-	BigInteger result;
-	result.digits.clear();
-	result.digits.reserve(std::max(digits.size(), other.digits.size()) + 1);
-	int64_t carry = 0;
-	size_t common_size = std::min(digits.size(), other.digits.size());
+BigInteger::TrialResult BigInteger::trialDivideByTable(size_t count, BigInteger& divisor, uint64_t root, unsigned threads) const {
+	if (root > std::numeric_limits<uint32_t>::max() && threads > 1 && count >= 2 * TRIAL_DIVISION_CHUNK) {
+		// 平方根超过 32 位时候选数不会让试除提前结束，可以分段并行，每段由所在线程解码
+		const size_t chunks = (count + TRIAL_DIVISION_CHUNK - 1) / TRIAL_DIVISION_CHUNK;
+		const uint32_t p = parallelFirstDivisor(chunks, threads, [&](size_t k, const std::atomic<size_t>& found) {
+			std::vector<uint32_t> candidates(TRIAL_DIVISION_CHUNK);
+			const size_t n = sPrimeTable.decode(k * TRIAL_DIVISION_CHUNK, std::min(TRIAL_DIVISION_CHUNK, count - k * TRIAL_DIVISION_CHUNK), candidates.data());
+			return firstDivisor(candidates.data(), n, k, found);
+		});
+		if (p != 0) {
+			divisor = p;
+			return TrialResult::Divisible;
+		}
+		return TrialResult::Undecided;
+	}
 
-	// 处理共同的位
-	for (size_t i = 0; i < common_size; ++i) {
-		carry += digits[i] + other.digits[i];
-		result.digits.push_back(carry % BASE);
-		carry /= BASE;
+	// 第一段只解码一批，之后逐段加倍，较小的数不必解码整段
+	std::vector<uint32_t> candidates;
+	size_t chunk = TRIAL_DIVISION_BATCH;
+	for (size_t index = 0; index < count; index += chunk, chunk = std::min(2 * chunk, TRIAL_DIVISION_CHUNK)) {
+		candidates.resize(std::min(chunk, count - index));
+		sPrimeTable.decode(index, candidates.size(), candidates.data());
+		const TrialResult result = trialDivide(candidates.data(), candidates.size(), divisor, root);
+		if (result != TrialResult::Undecided) {
+			return result;
+		}
 	}
 
-#if 1
-	auto& remain_digits = (digits.size() > common_size) ? digits : other.digits;
-	for (size_t i = common_size; i < remain_digits.size(); ++i) {
-		carry += remain_digits[i];
-		result.digits.push_back(carry % BASE);
-		carry /= BASE;
+	return TrialResult::Undecided;
+}
+
+BigInteger::TrialResult BigInteger::trialDivide(const uint32_t* candidates, size_t count, BigInteger& divisor, uint64_t root) const {
+	uint32_t remainders[TRIAL_DIVISION_BATCH];
+	for (size_t offset = 0; offset < count; offset += TRIAL_DIVISION_BATCH) {
+		const size_t batch = std::min(TRIAL_DIVISION_BATCH, count - offset);
+		limb::modSmallMany(digits.data(), digits.size(), candidates + offset, batch, remainders);
+		for (size_t j = 0; j < batch; ++j) {
+			const uint64_t p = candidates[offset + j];
+			// 先判断 p 是否超过平方根，自身作为候选数时不会被误判为因子
+			if (p > root) {
+				return TrialResult::Prime;
+			}
+			if (remainders[j] == 0) {
+				divisor = p;
+				return TrialResult::Divisible;
+			}
+		}
 	}
-#else
-	// 处理第一个大整数剩余的位
-	if (digits.size() > common_size) {
-		for (size_t i = common_size; i < digits.size(); ++i) {
-			carry += digits[i];
-			result.digits.push_back(carry % BASE);
-			carry /= BASE;
+
+	return TrialResult::Undecided;
+}
+
+uint32_t BigInteger::firstDivisor(const uint32_t* candidates, size_t count, size_t chunk, const std::atomic<size_t>& found) const {
+	uint32_t remainders[TRIAL_DIVISION_BATCH];
+	for (size_t offset = 0; offset < count; offset += TRIAL_DIVISION_BATCH) {
+		if (found.load(std::memory_order_relaxed) < chunk) {
+			return 0;
+		}
+		const size_t batch = std::min(TRIAL_DIVISION_BATCH, count - offset);
+		limb::modSmallMany(digits.data(), digits.size(), candidates + offset, batch, remainders);
+		for (size_t j = 0; j < batch; ++j) {
+			if (remainders[j] == 0) {
+				return candidates[offset + j];
+			}
 		}
 	}
-	// 处理第二个大整数剩余的位
-	else if (other.digits.size() > common_size) {
-		for (size_t i = common_size; i < other.digits.size(); ++i) {
-			carry += other.digits[i];
-			result.digits.push_back(carry % BASE);
-			carry /= BASE;
+
+	return 0;
+}
+
+bool BigInteger::fitsUint64(uint64_t& value) const {
+	// uint64_t 最大值约 1.8e19，最多占 3 块
+	if (digits.size() > 3) {
+		return false;
+	}
+
+	uint64_t low = digits[0];
+	if (digits.size() > 1) {
+		low += static_cast<uint64_t>(digits[1]) * BASE;
+	}
+	if (digits.size() == 3) {
+		const uint64_t high = digits[2];
+		const uint64_t unit = static_cast<uint64_t>(BASE) * BASE;
+		if (high > (std::numeric_limits<uint64_t>::max() - low) / unit) {
+			return false;
 		}
+		low += high * unit;
 	}
-#endif
 
-	// 处理最后可能的进位
-	if (carry > 0) {
-		result.digits.push_back(carry);
+	value = low;
+	return true;
+}
+
+int BigInteger::compareAbsolute(uint64_t value) const {
+	int32_t limbs[3];
+	size_t n = 0;
+	do {
+		limbs[n++] = static_cast<int32_t>(value % BASE);
+		value /= BASE;
+	} while (value > 0);
+
+	if (digits.size() != n) {
+		return digits.size() < n ? -1 : 1;
+	}
+	for (size_t i = n; i-- > 0; ) {
+		if (digits[i] != limbs[i]) {
+			return digits[i] < limbs[i] ? -1 : 1;
+		}
 	}
 
-	result.removeLeadingZeros();
-	return result;
+	return 0;
 }
 
-BigInteger BigInteger::innerSub(const BigInteger& other) const {
-	if (compareDigits(other) == std::strong_ordering::less) {
-		return other.innerSub(*this);
+void BigInteger::addAbsolute(const BigInteger& other) {
+	const size_t n = other.digits.size();
+	if (digits.size() < n) {
+		digits.resize(n);
 	}
 
-	BigInteger result;
-	result.digits.clear();
-	bool borrow = 0;
-	for (int i = 0; i < static_cast<int>(digits.size()); ++i) {
-		int64_t digit1 = digits[i];
-		int64_t digit2 = (i < static_cast<int>(other.digits.size())) ? other.digits[i] : 0;
-		int64_t diff = digit1 - digit2 - borrow;
-		borrow = diff < 0;
-		if (borrow) {
-			diff += BASE;
+	uint32_t carry = limb::addTo(digits.data(), digits.size(), other.digits.data(), n);
+	if (carry > 0) {
+		digits.push_back(static_cast<int32_t>(carry));
+	}
+}
+
+bool BigInteger::subAbsolute(const BigInteger& other) {
+	if (compareDigits(other) != std::strong_ordering::less) {
+		limb::subFrom(digits.data(), digits.size(), other.digits.data(), other.digits.size());
+		return false;
+	}
+
+	// 绝对值小于 other：原地计算 other - this
+	const size_t n = digits.size();
+	digits.resize(other.digits.size());
+	limb::sub(digits.data(), other.digits.data(), other.digits.size(), digits.data(), n);
+	return true;
+}
+
+void BigInteger::addAbsolute(uint64_t value) {
+	// 只处理 value 覆盖的低位块和进位
+	for (size_t i = 0; value > 0; ++i) {
+		if (i == digits.size()) {
+			digits.push_back(0);
 		}
-		result.digits.push_back(diff);
+		const uint64_t cur = static_cast<uint64_t>(digits[i]) + value % BASE;
+		digits[i] = static_cast<int32_t>(cur % BASE);
+		value = value / BASE + cur / BASE;
 	}
+}
 
-	result.removeLeadingZeros();
-	return result;
+bool BigInteger::subAbsolute(uint64_t value) {
+	if (compareAbsolute(value) < 0) {
+		// |this| < value，差值不超过 uint64_t，直接计算
+		uint64_t current = 0;
+		fitsUint64(current);
+		uint64_t diff = value - current;
+		digits.clear();
+		do {
+			digits.push_back(static_cast<int32_t>(diff % BASE));
+			diff /= BASE;
+		} while (diff > 0);
+		return true;
+	}
+
+	int64_t borrow = 0;
+	for (size_t i = 0; value > 0 || borrow != 0; ++i) {
+		int64_t cur = digits[i] - static_cast<int64_t>(value % BASE) - borrow;
+		value /= BASE;
+		borrow = cur < 0 ? 1 : 0;
+		digits[i] = static_cast<int32_t>(cur + borrow * BASE);
+	}
+	return false;
+}
+
+void BigInteger::mulAbsolute(uint64_t value) {
+	// value 拆成三块 v0 + v1 * BASE + v2 * BASE^2（v2 <= 18），
+	// 第 i 块累加 d[i] * v0 + d[i-1] * v1 + d[i-2] * v2，单遍原地完成
+	const uint64_t v0 = value % BASE;
+	const uint64_t v1 = value / BASE % BASE;
+	const uint64_t v2 = value / BASE / BASE;
+	const size_t n = digits.size();
+	const size_t extra = v2 > 0 ? 3 : (v1 > 0 ? 2 : 1);
+	digits.resize(n + extra, 0);
+
+	uint64_t prev1 = 0;
+	uint64_t prev2 = 0;
+	uint64_t carry = 0;
+	for (size_t i = 0; i < n + extra; ++i) {
+		const uint64_t d = static_cast<uint32_t>(digits[i]);
+		const uint64_t cur = d * v0 + prev1 * v1 + prev2 * v2 + carry;
+		digits[i] = static_cast<int32_t>(cur % BASE);
+		carry = cur / BASE;
+		prev2 = prev1;
+		prev1 = d;
+	}
+
+	removeLeadingZeros();
 }
 
 BigInteger BigInteger::innerMul(const BigInteger& other) const {
@@ -193,26 +472,145 @@ BigInteger BigInteger::innerMul(const BigInteger& other) const {
 		}
 		if (isPowerOfTen && other.digits.back() == 1) {
 			BigInteger result = *this;
-			for (size_t i = 0; i < other.digits.size() - 1; ++i) {
-				result.digits.insert(result.digits.begin(), 0);
-			}
+			result.digits.insert(result.digits.begin(), other.digits.size() - 1, 0);
 			result.removeLeadingZeros();
 			return result;
 		}
 	}
 
-	BigInteger result;
-	result.digits.clear();
-	result.digits.resize(digits.size() + other.digits.size());
+	// 内核的中间结果都从同一个临时缓冲区分配，递归的各层顺序复用
+	ScratchArena::Scope scope;
+	const BigInteger& a = (digits.size() >= other.digits.size()) ? *this : other;
+	const BigInteger& b = (digits.size() >= other.digits.size()) ? other : *this;
+	const size_t na = a.digits.size();
+	const size_t nb = b.digits.size();
+
+	// 较短的操作数不到 Toom-3 阈值：竖式乘法或 Karatsuba
+	if (nb < TOOM3_THRESHOLD) {
+		BigInteger result;
+		result.digits.resize(na + nb);
+		limb::mul(result.digits.data(), a.digits.data(), na, b.digits.data(), nb);
+		result.removeLeadingZeros();
+		return result;
+	}
+
+	// 足够大时使用 NTT
+	if (nb >= NTT_THRESHOLD && na + nb <= limb::NTT_MAX_LENGTH) {
+		BigInteger result;
+		result.digits.resize(na + nb);
+		limb::mulNtt(result.digits.data(), a.digits.data(), na, b.digits.data(), nb);
+		result.removeLeadingZeros();
+		return result;
+	}
+
+	// 长度相差悬殊：把较长的操作数按较短的长度分块，逐块相乘后累加
+	if (na >= 2 * nb) {
+		BigInteger result;
+		result.digits.assign(na + nb, 0);
+		for (size_t offset = 0; offset < na; offset += nb) {
+			BigInteger part = a.slice(offset, nb).innerMul(b);
+			limb::addTo(result.digits.data() + offset, na + nb - offset, part.digits.data(), part.digits.size());
+		}
+		result.removeLeadingZeros();
+		return result;
+	}
+
+	return toomCook3(a, b);
+}
+
+BigInteger BigInteger::innerSqr() const {
+	ScratchArena::Scope scope;
+	const size_t n = digits.size();
+
+	// 竖式平方或 Karatsuba 平方
+	if (n < TOOM3_THRESHOLD) {
+		BigInteger result;
+		result.digits.resize(2 * n);
+		limb::sqr(result.digits.data(), digits.data(), n);
+		result.removeLeadingZeros();
+		return result;
+	}
+
+	// NTT 平方只需一次正变换，阈值比乘法低
+	if (n >= NTT_SQR_THRESHOLD && 2 * n <= limb::NTT_MAX_LENGTH) {
+		BigInteger result;
+		result.digits.resize(2 * n);
+		limb::sqrNtt(result.digits.data(), digits.data(), n);
+		result.removeLeadingZeros();
+		return result;
+	}
+
+	return toomCook3(*this, *this);
+}
+
+BigInteger BigInteger::toomCook3(const BigInteger& a, const BigInteger& b) {
+	const size_t k = (std::max(a.digits.size(), b.digits.size()) + 2) / 3;
+	BigInteger a0 = a.slice(0, k);
+	BigInteger a1 = a.slice(k, k);
+	BigInteger a2 = a.slice(2 * k, k);
+
+	// 在 0、1、-1、-2、∞ 处求值
+	BigInteger t = a0 + a2;
+	BigInteger pm1 = t - a1;
+	BigInteger p1 = t + a1;
+	BigInteger pm2 = pm1 + a2;
+	pm2 = pm2 + pm2 - a0;
+
+	// 逐点相乘，递归回到 innerMul / innerSqr 选择算法；平方时只需对 a 求值
+	const bool square = &a == &b;
+	BigInteger r0;
+	BigInteger r1;
+	BigInteger rm1;
+	BigInteger rm2;
+	BigInteger r4;
+	if (square) {
+		r0 = a0.innerSqr();
+		r1 = p1.innerSqr();
+		rm1 = pm1.innerSqr();
+		rm2 = pm2.innerSqr();
+		r4 = a2.innerSqr();
+	}
+	else {
+		BigInteger b0 = b.slice(0, k);
+		BigInteger b1 = b.slice(k, k);
+		BigInteger b2 = b.slice(2 * k, k);
+
+		t = b0 + b2;
+		BigInteger qm1 = t - b1;
+		BigInteger q1 = t + b1;
+		BigInteger qm2 = qm1 + b2;
+		qm2 = qm2 + qm2 - b0;
+
+		r0 = a0 * b0;
+		r1 = p1 * q1;
+		rm1 = pm1 * qm1;
+		rm2 = pm2 * qm2;
+		r4 = a2 * b2;
+	}
 
-	for (size_t i = 0; i < digits.size(); ++i) {
-		int64_t carry = 0;
-		for (size_t j = 0; j < other.digits.size() || carry; ++j) {
-			int64_t cur = result.digits[i + j] +
-				static_cast<int64_t>(digits[i]) * (j < other.digits.size() ? other.digits[j] : 0) + carry;
-			result.digits[i + j] = static_cast<int64_t>(cur % BASE);
-			carry = static_cast<int64_t>(cur / BASE);
+	// Bodrato 插值序列，其中的除法都是整除
+	BigInteger r3 = rm2 - r1;
+	r3.divSmallInPlace(3);
+	r1 = r1 - rm1;
+	r1.divSmallInPlace(2);
+	BigInteger r2 = rm1 - r0;
+	r3 = r2 - r3;
+	r3.divSmallInPlace(2);
+	r3 = r3 + r4 + r4;
+	r2 = r2 + r1 - r4;
+	r1 = r1 - r3;
+
+	// 系数都是非负数，按 k 块的偏移累加
+	const size_t size = a.digits.size() + b.digits.size();
+	BigInteger result;
+	result.digits.assign(size, 0);
+	const BigInteger* coefficients[] = { &r0, &r1, &r2, &r3, &r4 };
+	for (size_t i = 0; i < 5; ++i) {
+		const BigInteger& c = *coefficients[i];
+		if (c.isZero()) {
+			continue;
 		}
+		limb::addTo(result.digits.data() + i * k, size - i * k, c.digits.data(), c.digits.size());
 	}
 
 	result.removeLeadingZeros();
@@ -246,42 +644,125 @@ std::pair<BigInteger, BigInteger> BigInteger::innerDiv(const BigInteger& divisor
 		}
 	}
 
+	if (compareDigits(divisor) == std::strong_ordering::less) {
+		BigInteger remainder = *this;
+		remainder.isNegative = false;
+		return { BigInteger(0), remainder };
+	}
+
+	// 除数和商都足够长时使用 Burnikel-Ziegler 递归除法
+	ScratchArena::Scope scope;
+	const size_t nu = digits.size();
+	const size_t nv = divisor.digits.size();
+	if (nv >= BURNIKEL_ZIEGLER_THRESHOLD && nu - nv >= BURNIKEL_ZIEGLER_OFFSET) {
+		return divBurnikelZiegler(divisor);
+	}
+
+	return divKnuth(divisor);
+}
+
+std::pair<BigInteger, BigInteger> BigInteger::divKnuth(const BigInteger& divisor) const {
+	if (compareDigits(divisor) == std::strong_ordering::less) {
+		BigInteger remainder = *this;
+		remainder.isNegative = false;
+		return { BigInteger(0), remainder };
+	}
+
+	// Knuth 算法 D，商和余数直接写入预先分配好的块
+	const size_t nu = digits.size();
+	const size_t nv = divisor.digits.size();
 	BigInteger quotient;
 	BigInteger remainder;
-	remainder.digits.reserve(digits.size());
+	quotient.digits.resize(nu - nv + 1);
+	remainder.digits.resize(nv);
+	limb::divmod(quotient.digits.data(), remainder.digits.data(),
+		digits.data(), nu, divisor.digits.data(), nv);
 
-	for (int i = digits.size() - 1; i >= 0; --i) {
-		remainder.digits.insert(remainder.digits.begin(), digits[i]);
-		remainder.removeLeadingZeros();
+	quotient.removeLeadingZeros();
+	remainder.removeLeadingZeros();
+	return { quotient, remainder };
+}
 
-		if (remainder.compareDigits(divisor) == std::strong_ordering::less) {
-			quotient.digits.insert(quotient.digits.begin(), 0);
-			continue;
-		}
+std::pair<BigInteger, BigInteger> BigInteger::divBurnikelZiegler(const BigInteger& divisor) const {
+	// 除数补齐到 n = j * m 块，其中 m 是 2 的幂，保证递归时每层都能对半拆分
+	const size_t s = divisor.digits.size();
+	size_t m = 1;
+	while (m <= s / BURNIKEL_ZIEGLER_THRESHOLD) {
+		m <<= 1;
+	}
+	const size_t j = (s + m - 1) / m;
+	const size_t n = j * m;
+	const size_t sigma = n - s;
 
-		int64_t left = 0, right = BASE - 1;
-		int64_t q = 0;
-		while (left <= right) {
-			int64_t mid = left + ((right - left) >> 1); // 使用位运算代替除法
-			BigInteger temp = divisor * mid;
-			if (temp.compareDigits(remainder) != std::strong_ordering::greater) {
-				q = mid;
-				left = mid + 1;
-			}
-			else {
-				right = mid - 1;
-			}
-		}
+	// 规范化：同乘 d 使除数最高块不小于 BASE / 2，再左移 sigma 块
+	const uint32_t d = static_cast<uint32_t>(BASE / (static_cast<int64_t>(divisor.digits.back()) + 1));
+	BigInteger b = divisor.innerMul(BigInteger(d)).shiftedLeft(sigma);
+	BigInteger a = innerMul(BigInteger(d)).shiftedLeft(sigma);
 
-		quotient.digits.insert(quotient.digits.begin(), q);
-		remainder = remainder - divisor * q;
+	// 被除数拆成 t 个 n 块的段，最高段小于 BASE^n / 2
+	const size_t t = std::max<size_t>(2, a.digits.size() / n + 1);
+	BigInteger quotient;
+	quotient.digits.assign((t - 1) * n, 0);
+	BigInteger z = a.slice((t - 2) * n, 2 * n);
+	BigInteger remainder;
+	for (size_t i = t - 1; i-- > 0; ) {
+		auto [q, r] = div2n1n(z, b, n);
+		std::copy(q.digits.begin(), q.digits.end(), quotient.digits.begin() + i * n);
+		if (i > 0) {
+			z = r.shiftedLeft(n) + a.slice((i - 1) * n, n);
+		}
+		else {
+			remainder = std::move(r);
+		}
 	}
 
+	// 余数去掉规范化因子
+	remainder = remainder.slice(sigma, remainder.digits.size());
+	remainder.divSmallInPlace(d);
 	quotient.removeLeadingZeros();
 	return { quotient, remainder };
 }
 
-auto BigInteger::operator<=>(const BigInteger& other) const {
+std::pair<BigInteger, BigInteger> BigInteger::div2n1n(const BigInteger& a, const BigInteger& b, size_t n) {
+	// 要求 a < b * BASE^n，b 为 n 块且已规范化
+	if (n % 2 != 0 || n < BURNIKEL_ZIEGLER_THRESHOLD) {
+		return a.divKnuth(b);
+	}
+
+	const size_t half = n / 2;
+	auto [q1, r] = div3n2n(a.slice(half, 3 * half), b, half);
+	auto [q2, s] = div3n2n(r.shiftedLeft(half) + a.slice(0, half), b, half);
+	return { q1.shiftedLeft(half) + q2, s };
+}
+
+std::pair<BigInteger, BigInteger> BigInteger::div3n2n(const BigInteger& a, const BigInteger& b, size_t half) {
+	// a 为 3 个 half 块，b 为 2 个 half 块：[a1, a2, a3] / [b1, b2]
+	BigInteger a12 = a.slice(half, 2 * half);
+	BigInteger b1 = b.slice(half, half);
+	BigInteger b2 = b.slice(0, half);
+
+	BigInteger q;
+	BigInteger r1;
+	if (a.slice(2 * half, half).compareDigits(b1) == std::strong_ordering::less) {
+		std::tie(q, r1) = div2n1n(a12, b1, half);
+	}
+	else {
+		// 商的估计值取 BASE^half - 1
+		q.digits.assign(half, static_cast<int32_t>(BASE - 1));
+		r1 = a12 - b1.shiftedLeft(half) + b1;
+	}
+
+	// 用 b2 修正估计值，最多修正两次
+	BigInteger rhat = r1.shiftedLeft(half) + a.slice(0, half) - q * b2;
+	while (rhat.isNegative) {
+		rhat = rhat + b;
+		q = q - BigInteger(1);
+	}
+
+	return { q, rhat };
+}
+
+std::strong_ordering BigInteger::operator<=>(const BigInteger& other) const {
 	if (isNegative != other.isNegative) {
 		return isNegative ? std::strong_ordering::less : std::strong_ordering::greater;
 	}
@@ -297,303 +778,1843 @@ auto BigInteger::operator<=>(const BigInteger& other) const {
 }
 
 bool BigInteger::operator==(const BigInteger& other) const {
-	return digits == other.digits;
+	return isNegative == other.isNegative && digits == other.digits;
 }
 
-bool BigInteger::operator==(int64_t other) const {
-	bool is_negative_other = other < 0;
-	if (isNegative != is_negative_other)
-		return false;
-
-	int i = 0;
-	int64_t absolute_other = is_negative_other ? -other : other;
-	std::lldiv_t tmp = std::lldiv(absolute_other, BASE);
-	while (tmp.quot > 0) {
-		if (digits[i] != tmp.rem)
-			return false;
-
-		++i;
-		tmp = std::lldiv(tmp.quot, BASE);
-	}
+bool BigInteger::operator<(const BigInteger& other) const {
+	return (*this <=> other) == std::strong_ordering::less;
+}
 
-	return i == digits.size() - 1 && (digits[i] == tmp.rem);
-	return true;
+bool BigInteger::operator<=(const BigInteger& other) const {
+	return (*this <=> other) != std::strong_ordering::greater;
 }
 
-bool BigInteger::operator<(const BigInteger& other) const {
-	return (*this <=> other) == std::strong_ordering::less;
+std::strong_ordering BigInteger::operator<=>(uint32_t other) const {
+	return *this <=> static_cast<uint64_t>(other);
 }
 
-bool BigInteger::operator<(int64_t other) const {
-	if (isNegative) {
-		if (other >= 0) {
-			return true;  // 负数小于非负数
-		}
-		// 两个负数比较绝对值
-		BigInteger abs_other(-other);
-		return compareDigitsAbsolute(abs_other) > 0;
+std::strong_ordering BigInteger::operator<=>(int64_t other) const {
+	if (other >= 0) {
+		return *this <=> static_cast<uint64_t>(other);
 	}
-	else {
-		if (other < 0) {
-			return false;  // 正数大于负数
-		}
-		// 两个正数比较
-		BigInteger abs_other(other);
-		return compareDigitsAbsolute(abs_other) < 0;
+	if (!isNegative) {
+		return std::strong_ordering::greater;
 	}
+
+	// 两个负数：绝对值大的反而小
+	return 0 <=> compareAbsolute(0 - static_cast<uint64_t>(other));
 }
 
-bool BigInteger::operator<=(const BigInteger& other) const {
-	// 实现比较逻辑，这里简单假设 digits 存储大整数的每一位
-	if (digits.size() < other.digits.size()) {
-		return true;
-	}
-	else if (digits.size() > other.digits.size()) {
-		return false;
+std::strong_ordering BigInteger::operator<=>(uint64_t other) const {
+	if (isNegative) {
+		return std::strong_ordering::less;
 	}
 
-	for (int i = digits.size() - 1; i >= 0; --i) {
-		if (digits[i] < other.digits[i]) {
-			return true;
-		}
-		else if (digits[i] > other.digits[i]) {
-			return false;
-		}
-	}
+	return compareAbsolute(other) <=> 0;
+}
 
-	return true;
+bool BigInteger::operator==(uint32_t other) const {
+	return (*this <=> other) == 0;
+}
+
+bool BigInteger::operator==(int64_t other) const {
+	return (*this <=> other) == 0;
+}
+
+bool BigInteger::operator==(uint64_t other) const {
+	return (*this <=> other) == 0;
+}
+
+bool BigInteger::operator<(int64_t other) const {
+	return (*this <=> other) < 0;
 }
 
 BigInteger BigInteger::operator+() const {
 	return BigInteger(*this);
 }
 
-BigInteger BigInteger::operator-() const {
+BigInteger BigInteger::operator-() const& {
 	BigInteger ret(*this);
-	ret.isNegative = !ret.isNegative;
+	ret.negate();
 	return ret;
 }
 
-BigInteger BigInteger::operator+(const BigInteger& other) const {
+BigInteger BigInteger::operator-() && {
+	negate();
+	return std::move(*this);
+}
+
+BigInteger& BigInteger::operator+=(const BigInteger& other) {
 	if (isNegative == other.isNegative) {
-		BigInteger result = innerAdd(other);
-		result.isNegative = isNegative;
-		return result;
-	}
-	else if (isNegative) {
-		BigInteger temp = *this;
-		temp.isNegative = false;
-		return other - temp;
+		addAbsolute(other);
 	}
-	else {
-		BigInteger temp = other;
-		temp.isNegative = false;
-		return *this - temp;
+	else if (subAbsolute(other)) {
+		isNegative = !isNegative;
 	}
-}
 
-BigInteger BigInteger::operator-(const BigInteger& other) const {
-	if (isNegative == other.isNegative) {
-		if (compareDigits(other) == std::strong_ordering::less) {
-			BigInteger result = other.innerSub(*this);
-			result.isNegative = !isNegative;
-			return result;
-		}
+	removeLeadingZeros();
+	return *this;
+}
 
-		BigInteger result = innerSub(other);
-		result.isNegative = isNegative;
-		return result;
-	}
-	else if (isNegative) {
-		BigInteger temp = *this;
-		temp.isNegative = false;
-		BigInteger result = temp + other;
-		result.isNegative = true;
-		return result;
+BigInteger& BigInteger::operator-=(const BigInteger& other) {
+	if (isNegative != other.isNegative) {
+		addAbsolute(other);
 	}
-	else {
-		BigInteger temp = other;
-		temp.isNegative = false;
-		return *this + temp;
+	else if (subAbsolute(other)) {
+		isNegative = !isNegative;
 	}
+
+	removeLeadingZeros();
+	return *this;
 }
 
-BigInteger BigInteger::operator*(const BigInteger& other) const {
-	BigInteger result = innerMul(other);
-	result.isNegative = isNegative != other.isNegative;
-	return result;
+BigInteger& BigInteger::operator*=(const BigInteger& other) {
+	*this = *this * other;
+	return *this;
 }
 
-BigInteger BigInteger::operator/(const BigInteger& other) const {
-	if (other.isZero()) {
-		throw std::invalid_argument("Division by zero");
-	}
+BigInteger& BigInteger::operator/=(const BigInteger& other) {
+	*this = *this / other;
+	return *this;
+}
 
-	BigInteger abs_dividend = *this;
-	abs_dividend.isNegative = false;
-	BigInteger abs_divisor = other;
-	abs_divisor.isNegative = false;
-	auto [quotient, _] = abs_dividend.innerDiv(abs_divisor);
-	quotient.isNegative = isNegative != other.isNegative;
-	return quotient;
+BigInteger& BigInteger::operator%=(const BigInteger& other) {
+	*this = *this % other;
+	return *this;
 }
 
-BigInteger BigInteger::operator%(const BigInteger& other) const {
-	if (other.isZero()) {
-		throw std::invalid_argument("Modulo by zero");
-	}
+BigInteger& BigInteger::operator+=(uint32_t other) {
+	return *this += static_cast<uint64_t>(other);
+}
+
+BigInteger& BigInteger::operator+=(int64_t other) {
+	// 取绝对值时避免 INT64_MIN 溢出
+	const uint64_t magnitude = other < 0 ? 0 - static_cast<uint64_t>(other) : static_cast<uint64_t>(other);
+	return other < 0 ? *this -= magnitude : *this += magnitude;
+}
+
+BigInteger& BigInteger::operator+=(uint64_t other) {
+	if (!isNegative) {
+		addAbsolute(other);
+	}
+	else if (subAbsolute(other)) {
+		isNegative = false;
+	}
+
+	removeLeadingZeros();
+	return *this;
+}
+
+BigInteger& BigInteger::operator-=(uint32_t other) {
+	return *this -= static_cast<uint64_t>(other);
+}
+
+BigInteger& BigInteger::operator-=(int64_t other) {
+	const uint64_t magnitude = other < 0 ? 0 - static_cast<uint64_t>(other) : static_cast<uint64_t>(other);
+	return other < 0 ? *this += magnitude : *this -= magnitude;
+}
+
+BigInteger& BigInteger::operator-=(uint64_t other) {
+	if (isNegative) {
+		addAbsolute(other);
+	}
+	else if (subAbsolute(other)) {
+		isNegative = true;
+	}
+
+	removeLeadingZeros();
+	return *this;
+}
+
+BigInteger& BigInteger::operator*=(uint32_t other) {
+	return *this *= static_cast<uint64_t>(other);
+}
+
+BigInteger& BigInteger::operator*=(int64_t other) {
+	const uint64_t magnitude = other < 0 ? 0 - static_cast<uint64_t>(other) : static_cast<uint64_t>(other);
+	*this *= magnitude;
+	if (other < 0) {
+		negate();
+	}
+	return *this;
+}
+
+BigInteger& BigInteger::operator*=(uint64_t other) {
+	mulAbsolute(other);
+	return *this;
+}
+
+BigInteger& BigInteger::operator/=(uint32_t other) {
+	if (other == 0) {
+		throw std::invalid_argument("Division by zero");
+	}
+
+	divSmallInPlace(other);
+	return *this;
+}
+
+BigInteger& BigInteger::operator/=(int64_t other) {
+	const uint64_t magnitude = other < 0 ? 0 - static_cast<uint64_t>(other) : static_cast<uint64_t>(other);
+	*this /= magnitude;
+	if (other < 0) {
+		negate();
+	}
+	return *this;
+}
+
+BigInteger& BigInteger::operator/=(uint64_t other) {
+	if (other <= std::numeric_limits<uint32_t>::max()) {
+		return *this /= static_cast<uint32_t>(other);
+	}
+
+	// 超过 32 位的除数不超过 3 块，存放在对象内部
+	*this = *this / BigInteger(other);
+	return *this;
+}
+
+BigInteger& BigInteger::operator%=(uint32_t other) {
+	const bool negative = isNegative;
+	const uint32_t remainder = mod(other);
+	digits.assign(1, 0);
+	isNegative = false;
+	addAbsolute(remainder);
+	if (negative) {
+		negate();
+	}
+	return *this;
+}
+
+BigInteger& BigInteger::operator%=(int64_t other) {
+	// 余数与被除数同号，与除数的符号无关
+	const uint64_t magnitude = other < 0 ? 0 - static_cast<uint64_t>(other) : static_cast<uint64_t>(other);
+	return *this %= magnitude;
+}
+
+BigInteger& BigInteger::operator%=(uint64_t other) {
+	if (other <= std::numeric_limits<uint32_t>::max()) {
+		return *this %= static_cast<uint32_t>(other);
+	}
+
+	*this = *this % BigInteger(other);
+	return *this;
+}
+
+std::pair<BigInteger, int64_t> BigInteger::divmod(uint32_t divisor) const {
+	if (divisor == 0) {
+		throw std::invalid_argument("Division by zero");
+	}
+
+	BigInteger quotient = *this;
+	const int64_t remainder = quotient.divSmallInPlace(divisor);
+	return { std::move(quotient), isNegative ? -remainder : remainder };
+}
+
+uint32_t BigInteger::mod(uint32_t divisor) const {
+	if (divisor == 0) {
+		throw std::invalid_argument("Modulo by zero");
+	}
+
+	return limb::modSmall(digits.data(), digits.size(), divisor);
+}
+
+BigInteger BigInteger::operator+(const BigInteger& other) const& {
+	// 预留进位的空间，避免相加时再次扩容
+	BigInteger result;
+	result.digits.reserve(std::max(digits.size(), other.digits.size()) + 1);
+	result = *this;
+	result += other;
+	return result;
+}
+
+BigInteger BigInteger::operator+(const BigInteger& other) && {
+	*this += other;
+	return std::move(*this);
+}
+
+BigInteger BigInteger::operator+(BigInteger&& other) const& {
+	other += *this;
+	return std::move(other);
+}
+
+BigInteger BigInteger::operator+(BigInteger&& other) && {
+	// 复用容量较大的一方
+	if (other.digits.capacity() > digits.capacity()) {
+		other += *this;
+		return std::move(other);
+	}
+
+	*this += other;
+	return std::move(*this);
+}
+
+BigInteger BigInteger::operator-(const BigInteger& other) const& {
+	BigInteger result;
+	result.digits.reserve(std::max(digits.size(), other.digits.size()) + 1);
+	result = *this;
+	result -= other;
+	return result;
+}
+
+BigInteger BigInteger::operator-(const BigInteger& other) && {
+	*this -= other;
+	return std::move(*this);
+}
+
+BigInteger BigInteger::operator-(BigInteger&& other) const& {
+	// a - b = -(b - a)
+	other -= *this;
+	other.negate();
+	return std::move(other);
+}
+
+BigInteger BigInteger::operator-(BigInteger&& other) && {
+	*this -= other;
+	return std::move(*this);
+}
+
+BigInteger BigInteger::operator*(const BigInteger& other) const {
+	if (this == &other) {
+		return square();
+	}
+
+	BigInteger result = innerMul(other);
+	result.isNegative = !result.isZero() && isNegative != other.isNegative;
+	return result;
+}
+
+BigInteger BigInteger::square() const {
+	return innerSqr();
+}
+
+BigInteger BigInteger::modPow(const BigInteger& exponent, const BigInteger& modulus) const {
+	if (modulus <= 0) {
+		throw std::invalid_argument("Modulus must be positive");
+	}
+	if (exponent.isNegative) {
+		throw std::invalid_argument("Negative exponent");
+	}
+	if (modulus == 1) {
+		return 0;
+	}
+	if (MontgomeryContext::isSupported(modulus)) {
+		return MontgomeryContext(modulus).pow(*this, exponent);
+	}
+
+	// 模数与 10 不互素，每次乘法后取余
+	BigInteger base = *this % modulus;
+	if (base.isNegative) {
+		base += modulus;
+	}
+	return slidingWindowPow<BigInteger>(base, exponent.toBinaryWords(), 1,
+		[&modulus](const BigInteger& x) { return x.square() % modulus; },
+		[&modulus](const BigInteger& x, const BigInteger& y) { return x * y % modulus; });
+}
+
+MontgomeryContext::MontgomeryContext(const BigInteger& modulus)
+	: mod(modulus), limbCount(modulus.digits.size()), negInverse(0) {
+	if (!isSupported(modulus)) {
+		throw std::invalid_argument("Montgomery modulus must be greater than 1 and coprime to 10");
+	}
+
+	// 扩展欧几里得求最低块模 BASE 的逆元
+	int64_t r0 = BigInteger::BASE, r1 = mod.digits[0];
+	int64_t t0 = 0, t1 = 1;
+	while (r1 != 0) {
+		const int64_t q = r0 / r1;
+		std::tie(r0, r1) = std::make_tuple(r1, r0 - q * r1);
+		std::tie(t0, t1) = std::make_tuple(t1, t0 - q * t1);
+	}
+	const int64_t inverse = (t0 % BigInteger::BASE + BigInteger::BASE) % BigInteger::BASE;
+	negInverse = static_cast<uint32_t>((BigInteger::BASE - inverse) % BigInteger::BASE);
+
+	rModN = BigInteger(1).shiftedLeft(limbCount) % mod;
+	rSquared = rModN.square() % mod;
+}
+
+bool MontgomeryContext::isSupported(const BigInteger& modulus) {
+	return modulus > 1 && modulus.digits[0] % 2 != 0 && modulus.digits[0] % 5 != 0;
+}
+
+BigInteger MontgomeryContext::reduce(BigInteger&& t) const {
+	t.digits.resize(2 * limbCount, 0);
+	return reduce(t.digits.data());
+}
+
+BigInteger MontgomeryContext::reduce(const int32_t* t) const {
+	BigInteger::Digits result(limbCount);
+	limb::montgomeryReduce(result.data(), t, mod.digits.data(), limbCount, negInverse);
+	return BigInteger(std::move(result), false);
+}
+
+BigInteger MontgomeryContext::toMontgomery(const BigInteger& x) const {
+	BigInteger value = x % mod;
+	if (value.isNegative) {
+		value += mod;
+	}
+	return reduce(value * rSquared);
+}
+
+BigInteger MontgomeryContext::fromMontgomery(const BigInteger& x) const {
+	return reduce(BigInteger(x));
+}
+
+BigInteger MontgomeryContext::multiply(const BigInteger& a, const BigInteger& b) const {
+	if (2 * limbCount > STACK_PRODUCT_LIMBS) {
+		return reduce(a * b);
+	}
+	// 模数较小时乘积放在栈上直接约简，不分配内存
+	int32_t product[STACK_PRODUCT_LIMBS];
+	const size_t na = a.digits.size();
+	const size_t nb = b.digits.size();
+	limb::mul(product, a.digits.data(), na, b.digits.data(), nb);
+	std::fill(product + na + nb, product + 2 * limbCount, 0);
+	return reduce(product);
+}
+
+BigInteger MontgomeryContext::square(const BigInteger& a) const {
+	if (2 * limbCount > STACK_PRODUCT_LIMBS) {
+		return reduce(a.square());
+	}
+	int32_t product[STACK_PRODUCT_LIMBS];
+	const size_t na = a.digits.size();
+	limb::sqr(product, a.digits.data(), na);
+	std::fill(product + 2 * na, product + 2 * limbCount, 0);
+	return reduce(product);
+}
+
+BigInteger MontgomeryContext::pow(const BigInteger& base, const BigInteger& exponent) const {
+	if (exponent.isNegative) {
+		throw std::invalid_argument("Negative exponent");
+	}
+	const BigInteger result = slidingWindowPow<BigInteger>(toMontgomery(base), exponent.toBinaryWords(), rModN,
+		[this](const BigInteger& x) { return square(x); },
+		[this](const BigInteger& x, const BigInteger& y) { return multiply(x, y); });
+	return fromMontgomery(result);
+}
+
+BigInteger BigInteger::operator/(const BigInteger& other) const {
+	if (other.isZero()) {
+		throw std::invalid_argument("Division by zero");
+	}
+
+	BigInteger abs_dividend = *this;
+	abs_dividend.isNegative = false;
+	BigInteger abs_divisor = other;
+	abs_divisor.isNegative = false;
+	auto [quotient, _] = abs_dividend.innerDiv(abs_divisor);
+	quotient.isNegative = !quotient.isZero() && isNegative != other.isNegative;
+	return quotient;
+}
+
+BigInteger BigInteger::operator%(const BigInteger& other) const {
+	if (other.isZero()) {
+		throw std::invalid_argument("Modulo by zero");
+	}
+
+	BigInteger abs_dividend = *this;
+	abs_dividend.isNegative = false;
+	BigInteger abs_divisor = other;
+	abs_divisor.isNegative = false;
+	auto [_, remainder] = abs_dividend.innerDiv(abs_divisor);
+	remainder.isNegative = !remainder.isZero() && isNegative;
+	return remainder;
+}
+
+bool BigInteger::isPrimeNumber() const {
+	BigInteger divisor;
+	return isPrimeNumber(divisor);
+}
+
+bool BigInteger::isPrimeNumber(BigInteger& divisor) const noexcept {
+	return isPrimeNumber(divisor, PrimalityOptions{});
+}
+
+bool BigInteger::isProbablePrime(int extraRounds) const {
+	BigInteger divisor;
+	PrimalityOptions options;
+	options.mode = PrimalityMode::Probabilistic;
+	options.extraRounds = extraRounds;
+	return isPrimeNumber(divisor, options);
+}
+
+bool BigInteger::isPrimeNumber(BigInteger& divisor, const PrimalityOptions& options) const {
+	// 特殊情况
+	if (*this < 2) return false;
+
+	if (*this == 2 || *this == 3 || *this == 5) {
+		return true;
+	}
+
+	auto isDivBy235 = [this](BigInteger& divisor) {
+		bool ret = true;
+		int32_t last_digit = digits[0];
+		if (last_digit % 2 == 0) {
+			divisor = 2;
+		}
+		else if (mod3() == 0) {
+			divisor = 3;
+		}
+		else if (last_digit % 5 == 0) {
+			divisor = 5;
+		}
+		else {
+			ret = false;
+		}
+
+		return ret;
+	};
+
+	if (isDivBy235(divisor)) {
+		return false;
+	}
+
+	// 概率模式只试除到 trialBound
+	const uint64_t limit = options.mode == PrimalityMode::Exhaustive
+		? std::numeric_limits<uint64_t>::max() : options.trialBound;
+	const unsigned threads = options.threads != 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+	uint64_t start = 7;
+	int step_index = 0;
+	// 平方根只计算一次，之后候选数只与它比较
+	const uint64_t root = sqrtBound();
+
+#if 1
+	// 使用素数文件进行快速判断
+	if (loadPrimeTable()) {
+		uint64_t value = 0;
+		const bool small = fitsUint64(value);
+		if (small && value <= std::numeric_limits<uint32_t>::max() && sPrimeTable.contains(static_cast<uint32_t>(value))) {
+			return true;
+		}
+
+		// 概率模式只用不超过 limit 的素数
+		const size_t count = limit >= sPrimeTable.back() ? sPrimeTable.size()
+			: sPrimeTable.upperBound(static_cast<uint32_t>(limit));
+		switch (trialDivideByTable(count, divisor, root, threads)) {
+		case TrialResult::Divisible:
+			return false;
+		case TrialResult::Prime:
+			return true;
+		default:
+			break;
+		}
+
+		if (count < sPrimeTable.size()) {
+			// 已到达试除上界，跳过轮试除
+			start = limit + 1;
+		}
+		else {
+			start = sPrimeTable.back();
+			step_index = wheelStepIndex(sPrimeTable.back());
+		}
+	}
+#endif
+	// 素数文件加载失败时从 7 开始判断
+	switch (checkPrimeWithStep(divisor, start, step_index, limit, root, threads)) {
+	case TrialResult::Divisible:
+		return false;
+	case TrialResult::Prime:
+		return true;
+	default:
+		break;
+	}
+
+	// 只有概率模式会走到这里：试除没有找到因子，也没有到达平方根
+	if (!isStrongProbablePrime(2) || !isStrongLucasProbablePrime()) {
+		return false;
+	}
+
+	// 追加的 Miller-Rabin 底数取伪随机数，以自身为种子使结果可以复现
+	std::mt19937_64 engine(digits[0] ^ (static_cast<uint64_t>(digits.back()) << 32) ^ digits.size());
+	for (int round = 0; round < options.extraRounds; ++round) {
+		// 底数取 [3, 2^63)
+		if (!isStrongProbablePrime(3 + (engine() >> 1))) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+namespace {
+
+// 雅可比符号 (a/m)，m 为正奇数
+int jacobiSymbol(uint64_t a, uint64_t m) {
+	int result = 1;
+	a %= m;
+	while (a != 0) {
+		while (a % 2 == 0) {
+			a /= 2;
+			const uint64_t r = m % 8;
+			if (r == 3 || r == 5) {
+				result = -result;
+			}
+		}
+		std::swap(a, m);
+		if (a % 4 == 3 && m % 4 == 3) {
+			result = -result;
+		}
+		a %= m;
+	}
+	return m == 1 ? result : 0;
+}
+
+} // namespace
+
+std::vector<uint32_t> BigInteger::toBinaryWords() const {
+	std::vector<uint32_t> words;
+	BigInteger value = *this;
+	value.isNegative = false;
+	while (!value.isZero()) {
+		const uint32_t low = value.divSmallInPlace(1u << 16);
+		const uint32_t high = value.divSmallInPlace(1u << 16);
+		words.push_back(low | (high << 16));
+	}
+	return words;
+}
+
+namespace {
+
+// base^exponent，平方-乘
+BigInteger power(const BigInteger& base, uint32_t exponent) {
+	BigInteger result = 1;
+	BigInteger square = base;
+	while (exponent != 0) {
+		if (exponent & 1) {
+			result *= square;
+		}
+		exponent >>= 1;
+		if (exponent != 0) {
+			square = square.square();
+		}
+	}
+	return result;
+}
+
+// 模 64、63、65、11 的二次剩余，64 * 63 * 65 * 11 在 32 位以内，一次取模即可
+constexpr uint32_t SQUARE_MODULI[] = { 64, 63, 65, 11 };
+constexpr auto SQUARE_RESIDUES = [] {
+	std::array<std::array<bool, 65>, 4> residues{};
+	for (size_t i = 0; i < 4; ++i) {
+		for (uint32_t x = 0; x < SQUARE_MODULI[i]; ++x) {
+			residues[i][x * x % SQUARE_MODULI[i]] = true;
+		}
+	}
+	return residues;
+}();
+
+} // namespace
+
+BigInteger BigInteger::floorRoot(uint32_t k) const {
+	BigInteger n = *this;
+	n.isNegative = false;
+	if (k == 1 || n < 2u) {
+		return n;
+	}
+	// 每块不足 30 位，k 不小于位数时 n < 2^k，根为 1；不再用初值 2 计算 2^(k-1)
+	const size_t bitBound = (digits.size() - 1) * 30 + std::bit_width(static_cast<uint32_t>(digits.back()));
+	if (k >= bitBound) {
+		return BigInteger(1);
+	}
+
+	uint64_t value = 0;
+	if (k == 2 && fitsUint64(value)) {
+		// 浮点初值最多差 1，逐步修正
+		uint64_t root = static_cast<uint64_t>(std::sqrt(static_cast<double>(value)));
+		while (root > std::numeric_limits<uint32_t>::max() || root * root > value) {
+			--root;
+		}
+		while (root < std::numeric_limits<uint32_t>::max() && (root + 1) * (root + 1) <= value) {
+			++root;
+		}
+		return BigInteger(root);
+	}
+
+	// 初值须不小于真实的根，之后单调下降，不再下降时即为结果
+	BigInteger x;
+	const size_t size = digits.size();
+	const size_t shift = size / (2 * static_cast<size_t>(k));
+	if (shift >= 2) {
+		// 去掉低 k * shift 块后求根，加 1 再移回，有效位数约为结果的一半
+		x = n.slice(k * shift, size - k * shift).floorRoot(k) + 1u;
+		x = x.shiftedLeft(shift);
+	}
+	else {
+		// 最高三块的浮点近似，放大 1e-6 并加 1 以确保不小于真实的根
+		const size_t top = std::min<size_t>(size, 3);
+		double leading = 0;
+		for (size_t i = size; i-- > size - top;) {
+			leading = leading * BASE + digits[i];
+		}
+		const double exponent = (std::log10(leading) + static_cast<double>(DIGIT_WIDTH * (size - top))) / k;
+		const int64_t scale = exponent < 17 ? 0 : static_cast<int64_t>(exponent) - 17;
+		x = BigInteger(static_cast<uint64_t>(std::pow(10.0, exponent - scale) * (1 + 1e-6)) + 1);
+		for (int64_t i = 0; i < scale % DIGIT_WIDTH; ++i) {
+			x *= 10u;
+		}
+		x = x.shiftedLeft(static_cast<size_t>(scale / DIGIT_WIDTH));
+	}
+
+	// 以 2 为底的对数近似，取最高三块
+	const auto log2Of = [](const BigInteger& v) {
+		const size_t top = std::min<size_t>(v.digits.size(), 3);
+		double leading = 0;
+		for (size_t i = v.digits.size(); i-- > v.digits.size() - top;) {
+			leading = leading * BASE + v.digits[i];
+		}
+		return std::log2(leading) + static_cast<double>(v.digits.size() - top) * (DIGIT_WIDTH * std::log2(10.0));
+	};
+	const double log2n = log2Of(n);
+
+	while (true) {
+		// y = ((k - 1) x + n / x^(k-1)) / k；x^(k-1) 明显大于 n 时商为 0，不计算幂，
+		// 因此算出的幂至多比 n 大几倍
+		BigInteger y = x * (k - 1);
+		if ((k - 1) * log2Of(x) <= log2n + 1) {
+			y += n / power(x, k - 1);
+		}
+		y.divSmallInPlace(k);
+		if (y >= x) {
+			return x;
+		}
+		x = std::move(y);
+	}
+}
+
+BigInteger BigInteger::isqrt() const {
+	if (isNegative) {
+		throw std::invalid_argument("Square root of a negative number");
+	}
+	return floorRoot(2);
+}
+
+BigInteger BigInteger::iroot(uint32_t k) const {
+	if (k == 0) {
+		throw std::invalid_argument("Root degree must be positive");
+	}
+	if (isNegative && k % 2 == 0) {
+		throw std::invalid_argument("Even root of a negative number");
+	}
+
+	BigInteger root = floorRoot(k);
+	if (isNegative) {
+		root.negate();
+	}
+	return root;
+}
+
+bool BigInteger::isPerfectSquare() const {
+	if (isNegative) {
+		return false;
+	}
+
+	const uint32_t r = mod(64u * 63u * 65u * 11u);
+	for (size_t i = 0; i < std::size(SQUARE_MODULI); ++i) {
+		if (!SQUARE_RESIDUES[i][r % SQUARE_MODULI[i]]) {
+			return false;
+		}
+	}
+	return floorRoot(2).square() == *this;
+}
+
+uint64_t BigInteger::sqrtBound() const {
+	// (2^64)^2 不到 39 位十进制数，超过 5 块时平方根必然超过 uint64_t
+	uint64_t root = 0;
+	if (digits.size() > 5 || !floorRoot(2).fitsUint64(root)) {
+		return std::numeric_limits<uint64_t>::max();
+	}
+	return root;
+}
+
+bool BigInteger::isStrongProbablePrime(uint64_t base) const {
+	const BigInteger& n = *this;
+	uint64_t a = base;
+	uint64_t value = 0;
+	if (n.fitsUint64(value)) {
+		a %= value;
+	}
+	if (a <= 1 || n.compareAbsolute(a + 1) == 0) {
+		return true;
+	}
+
+	// N - 1 = d * 2^s，d 为奇数
+	BigInteger d = n - 1;
+	size_t s = 0;
+	while (d.digits[0] % 2 == 0) {
+		d.divSmallInPlace(2);
+		++s;
+	}
+
+	// 后续平方在 Montgomery 形式下进行，1 和 N - 1 分别对应 R 和 N - R
+	const MontgomeryContext context(n);
+	const BigInteger minusOne = n - context.one();
+	BigInteger x = context.toMontgomery(context.pow(a, d));
+	if (x == context.one() || x == minusOne) {
+		return true;
+	}
+	for (size_t r = 1; r < s; ++r) {
+		x = context.square(x);
+		if (x == minusOne) {
+			return true;
+		}
+		if (x == context.one()) {
+			return false;
+		}
+	}
+	return false;
+}
+
+bool BigInteger::isStrongLucasProbablePrime() const {
+	const BigInteger& n = *this;
+	const bool nIs3Mod4 = digits[0] % 4 == 3;
+
+	// Selfridge 方法 A：在 5, -7, 9, -11, ... 中找第一个使 (D/N) = -1 的 D
+	int64_t D = 5;
+	for (int attempt = 1;; ++attempt) {
+		const uint32_t m = static_cast<uint32_t>(D > 0 ? D : -D);
+		// 二次互反律：(m/N) = (N/m)，m 与 N 都模 4 余 3 时变号；(-1/N) = (-1)^((N-1)/2)
+		int j = jacobiSymbol(n.mod(m), m);
+		if (m % 4 == 3 && nIs3Mod4) {
+			j = -j;
+		}
+		if (D < 0 && nIs3Mod4) {
+			j = -j;
+		}
+
+		if (j == -1) {
+			break;
+		}
+		if (j == 0) {
+			// N 与 |D| 有公因子
+			return n.compareAbsolute(m) == 0;
+		}
+		// 完全平方数找不到这样的 D，搜索几次失败后检查一次
+		if (attempt == 8 && n.isPerfectSquare()) {
+			return false;
+		}
+		D = D > 0 ? -(D + 2) : -D + 2;
+	}
+	const int64_t Q = (1 - D) / 4;
+	const MontgomeryContext context(n);
+
+	// 结果取 [0, N) 内的代表元，只用于乘以小整数之后
+	auto reduce = [&n](const BigInteger& x) {
+		BigInteger r = x % n;
+		if (r < 0) {
+			r += n;
+		}
+		return r;
+	};
+	// 模 N 除以 2，x 在 [0, 2N) 内
+	auto half = [&n](BigInteger x) {
+		if (x >= n) {
+			x -= n;
+		}
+		if (x.digits[0] % 2 != 0) {
+			x += n;
+		}
+		x.divSmallInPlace(2);
+		return x;
+	};
+
+	// N + 1 = d * 2^s，d 为奇数
+	BigInteger d = n + 1;
+	size_t s = 0;
+	while (d.digits[0] % 2 == 0) {
+		d.divSmallInPlace(2);
+		++s;
+	}
+
+	// V_k^2 - 2Q^k 在 (-2N, N) 内
+	auto squareMinusTwice = [&n, &context](const BigInteger& v, const BigInteger& qk) {
+		BigInteger r = context.square(v) - qk * 2;
+		while (r < 0) {
+			r += n;
+		}
+		return r;
+	};
+
+	// P = 1，按 d 的二进制位从高到低计算 U_d、V_d 和 Q^d，全部在 Montgomery 形式下进行：
+	// U_2k = U_k V_k，V_2k = V_k^2 - 2Q^k，U_2k+1 = (U_2k + V_2k) / 2，V_2k+1 = (D U_2k + V_2k) / 2
+	const std::vector<uint32_t> words = d.toBinaryWords();
+	const size_t bits = (words.size() - 1) * 32 + std::bit_width(words.back());
+	BigInteger u = context.one();
+	BigInteger v = context.one();
+	BigInteger qk = context.toMontgomery(BigInteger() + Q);
+	for (size_t i = bits - 1; i-- > 0;) {
+		u = context.multiply(u, v);
+		v = squareMinusTwice(v, qk);
+		qk = context.square(qk);
+		if ((words[i / 32] >> (i % 32)) & 1) {
+			BigInteger nextU = half(u + v);
+			v = half(reduce(u * D) + v);
+			u = std::move(nextU);
+			qk = reduce(qk * Q);
+		}
+	}
+
+	if (u == 0 || v == 0) {
+		return true;
+	}
+	// 检查 V_(d*2^r) = 0，0 < r < s
+	for (size_t r = 1; r < s; ++r) {
+		v = squareMinusTwice(v, qk);
+		if (v == 0) {
+			return true;
+		}
+		qk = context.square(qk);
+	}
+	return false;
+}
+
+std::pair<BigInteger, BigInteger> BigInteger::fibonacciDoubling(uint64_t k) {
+	// 从 (F(1), F(0)) 开始，按 k 的二进制位从高到低倍增：
+	// F(2i+1) = 4F(i)^2 - F(i-1)^2 + 2(-1)^i
+	// F(2i-1) = F(i)^2 + F(i-1)^2
+	// F(2i)   = F(2i+1) - F(2i-1)
+	BigInteger f(1);
+	BigInteger g(0);
+	bool odd = true;
+	for (int i = std::bit_width(k) - 2; i >= 0; --i) {
+		BigInteger a = f.square();
+		BigInteger b = g.square();
+		BigInteger prev = a + b;
+		a *= 4u;
+		a -= b;
+		a += odd ? -2 : 2;
+		BigInteger mid = a - prev;
+
+		odd = ((k >> i) & 1) != 0;
+		if (odd) {
+			f = std::move(a);
+			g = std::move(mid);
+		}
+		else {
+			f = std::move(mid);
+			g = std::move(prev);
+		}
+	}
+
+	return { std::move(f), std::move(g) };
+}
+
+BigInteger BigInteger::fibonacci(int64_t n) {
+	if (n < 0) {
+		throw std::invalid_argument("Fibonacci is not defined for negative numbers.");
+	}
+	if (n < 2) return BigInteger(static_cast<uint64_t>(n));
+
+	// 最后一步只需要一个值，用一次乘法代替两次平方
+	const uint64_t k = static_cast<uint64_t>(n) >> 1;
+	auto [f, g] = fibonacciDoubling(k);
+	if (n & 1) {
+		// F(2k+1) = (2F(k) + F(k-1)) * (2F(k) - F(k-1)) + 2(-1)^k
+		BigInteger sum = f * 2u + g;
+		BigInteger diff = std::move(f) * 2u - g;
+		BigInteger result = sum * diff;
+		result += (k & 1) ? -2 : 2;
+		return result;
+	}
+
+	// F(2k) = F(k) * (F(k) + 2F(k-1))
+	BigInteger sum = f + g * 2u;
+	return f * sum;
+}
+
+std::pair<BigInteger, BigInteger> BigInteger::fibonacciPair(int64_t n) {
+	if (n < 0) {
+		throw std::invalid_argument("Fibonacci is not defined for negative numbers.");
+	}
+
+	auto [next, current] = fibonacciDoubling(static_cast<uint64_t>(n) + 1);
+	return { std::move(current), std::move(next) };
+}
+
+BigInteger BigInteger::lucas(int64_t n) {
+	if (n < 0) {
+		throw std::invalid_argument("Lucas is not defined for negative numbers.");
+	}
+	if (n == 0) return BigInteger(2);
+	if (n == 1) return BigInteger(1);
+
+	const uint64_t k = static_cast<uint64_t>(n) >> 1;
+	auto [f, g] = fibonacciDoubling(k);
+	// L(k) = F(k) + 2F(k-1)
+	BigInteger lk = f + g * 2u;
+	if (n & 1) {
+		// L(2k+1) = L(k) * L(k+1) - (-1)^k，L(k+1) = 3F(k) + F(k-1)
+		BigInteger lk1 = std::move(f) * 3u + g;
+		BigInteger result = lk * lk1;
+		result += (k & 1) ? 1 : -1;
+		return result;
+	}
+
+	// L(2k) = L(k)^2 - 2(-1)^k
+	BigInteger result = lk.square();
+	result += (k & 1) ? 2 : -2;
+	return result;
+}
+
+namespace {
+
+// 叶子内的因子先在 uint64_t 内合并，叶子之间两两平衡相乘，使大乘法落在规模相近的操作数上
+constexpr uint64_t PRODUCT_LEAF_SIZE = 16;
+
+// factor(i) 对 i ∈ [first, first + count) 给出各个因子，要求均不为零
+template <typename Factor>
+BigInteger balancedProduct(uint64_t first, uint64_t count, const Factor& factor) {
+	if (count <= PRODUCT_LEAF_SIZE) {
+		BigInteger result(1);
+		uint64_t acc = 1;
+		for (uint64_t i = first; i < first + count; ++i) {
+			const uint64_t value = factor(i);
+			if (acc > std::numeric_limits<uint64_t>::max() / value) {
+				result *= acc;
+				acc = value;
+			}
+			else {
+				acc *= value;
+			}
+		}
+		result *= acc;
+		return result;
+	}
+
+	const uint64_t half = count / 2;
+	return balancedProduct(first, half, factor) * balancedProduct(first + half, count - half, factor);
+}
+
+// 不超过 n 的全部素数，只筛奇数
+std::vector<uint32_t> sievePrimes(uint32_t n) {
+	std::vector<uint32_t> primes;
+	if (n < 2) {
+		return primes;
+	}
+
+	primes.push_back(2);
+	// composite[i] 对应奇数 2i + 1
+	std::vector<bool> composite(n / 2 + 1, false);
+	for (uint64_t i = 1; 2 * i + 1 <= n; ++i) {
+		if (composite[i]) {
+			continue;
+		}
+		const uint64_t p = 2 * i + 1;
+		primes.push_back(static_cast<uint32_t>(p));
+		for (uint64_t j = p * p / 2; 2 * j + 1 <= n; j += p) {
+			composite[j] = true;
+		}
+	}
+
+	return primes;
+}
+
+// swing(n) = n! / ((n/2)!)^2，其中素数 p 的指数为 Σ floor(n / p^k) mod 2，p 的幂不超过 n
+BigInteger primeSwingFactorial(uint32_t n, const std::vector<uint32_t>& primes) {
+	if (n <= 20) {
+		uint64_t result = 1;
+		for (uint32_t i = 2; i <= n; ++i) {
+			result *= i;
+		}
+		return BigInteger(result);
+	}
+
+	BigInteger half = primeSwingFactorial(n / 2, primes);
+
+	std::vector<uint64_t> factors;
+	for (uint32_t p : primes) {
+		if (p > n) {
+			break;
+		}
+		uint64_t power = 1;
+		for (uint64_t q = n / p; q > 0; q /= p) {
+			if (q & 1) {
+				power *= p;
+			}
+		}
+		if (power > 1) {
+			factors.push_back(power);
+		}
+	}
+
+	BigInteger swing = balancedProduct(0, factors.size(), [&factors](uint64_t i) { return factors[i]; });
+	return half.square() * swing;
+}
+
+}
+
+BigInteger BigInteger::factorial(int64_t n) {
+	if (n < 0) {
+		throw std::invalid_argument("Factorial is not defined for negative numbers.");
+	}
+	if (n > std::numeric_limits<uint32_t>::max()) {
+		throw std::invalid_argument("Factorial argument is too large.");
+	}
 
-	BigInteger abs_dividend = *this;
-	abs_dividend.isNegative = false;
-	BigInteger abs_divisor = other;
-	abs_divisor.isNegative = false;
-	auto [_, remainder] = abs_dividend.innerDiv(abs_divisor);
-	remainder.isNegative = isNegative;
-	return remainder;
+	const uint32_t m = static_cast<uint32_t>(n);
+	return primeSwingFactorial(m, sievePrimes(m));
 }
 
-bool BigInteger::isPrimeNumber() const {
-	BigInteger divisor;
-	return isPrimeNumber(divisor);
+BigInteger BigInteger::primorial(int64_t n) {
+	if (n > std::numeric_limits<uint32_t>::max()) {
+		throw std::invalid_argument("Primorial argument is too large.");
+	}
+	if (n < 2) {
+		return BigInteger(1);
+	}
+
+	const std::vector<uint32_t> primes = sievePrimes(static_cast<uint32_t>(n));
+	return balancedProduct(0, primes.size(), [&primes](uint64_t i) { return static_cast<uint64_t>(primes[i]); });
 }
 
-bool BigInteger::isPrimeNumber(BigInteger& divisor) const noexcept {
-	// 特殊情况
-	if (*this < 2) return false;
+BigInteger BigInteger::rangeProduct(int64_t a, int64_t b) {
+	if (a > b) {
+		return BigInteger(1);
+	}
+	if (a <= 0 && b >= 0) {
+		return BigInteger(0);
+	}
 
-	if (*this == 2 || *this == 3 || *this == 5) {
-		return true;
+	auto identity = [](uint64_t i) { return i; };
+	if (b < 0) {
+		// 全为负数：|b| * ... * |a|，个数为奇数时结果为负
+		const uint64_t low = 0 - static_cast<uint64_t>(b);
+		const uint64_t count = (0 - static_cast<uint64_t>(a)) - low + 1;
+		BigInteger result = balancedProduct(low, count, identity);
+		if (count & 1) {
+			result.negate();
+		}
+		return result;
 	}
 
-	auto isDivBy235 = [this](BigInteger& divisor) {
-		bool ret = true;
-		int32_t last_digit = digits[0];
-		if (last_digit % 2 == 0) {
-			divisor = 2;
+	return balancedProduct(static_cast<uint64_t>(a), static_cast<uint64_t>(b - a) + 1, identity);
+}
+
+bool BigInteger::removeFactors(const uint32_t* candidates, size_t count, std::vector<BigInteger>& factors) {
+	// 除去一个因子后，同一批中其它候选数的整除性不变，余数不必重算；平方根只在除去因子后重算
+	uint64_t root = sqrtBound();
+	uint32_t remainders[TRIAL_DIVISION_BATCH];
+	for (size_t offset = 0; offset < count; offset += TRIAL_DIVISION_BATCH) {
+		const size_t batch = std::min(TRIAL_DIVISION_BATCH, count - offset);
+		limb::modSmallMany(digits.data(), digits.size(), candidates + offset, batch, remainders);
+		for (size_t j = 0; j < batch; ++j) {
+			const uint32_t p = candidates[offset + j];
+			if (remainders[j] == 0) {
+				do {
+					divSmallInPlace(p);
+					factors.push_back(p);
+				} while (mod(p) == 0);
+				root = sqrtBound();
+			}
+			// 剩余部分没有不超过 p 的因子，p 超过其平方根时为 1 或素数
+			if (p > root) {
+				if (*this > 1u) {
+					factors.push_back(*this);
+					*this = 1;
+				}
+				return true;
+			}
 		}
-		else if (last_digit % 5 == 0) {
-			divisor = 5;
+	}
+
+	return false;
+}
+
+bool BigInteger::removeWheelFactors(uint64_t start, int stepIndex, uint64_t bound, std::vector<BigInteger>& factors) {
+	uint64_t x = start;
+	uint32_t candidates[TRIAL_DIVISION_BATCH];
+	while (x <= bound) {
+		size_t count = 0;
+		while (count < TRIAL_DIVISION_BATCH && x <= bound) {
+			candidates[count++] = static_cast<uint32_t>(x);
+			x += STEP[stepIndex];
+			++stepIndex;
+			stepIndex %= STEP_COUNT;
 		}
-		else if (mod3() == 0) {
-			divisor = 3;
+		if (removeFactors(candidates, count, factors)) {
+			return true;
 		}
-		else {
-			ret = false;
+	}
+
+	return false;
+}
+
+struct BigInteger::GcdMatrix {
+	BigInteger m00 = 1;
+	BigInteger m01 = 0;
+	BigInteger m10 = 0;
+	BigInteger m11 = 1;
+
+	// 先做 other 再做 this
+	GcdMatrix operator*(const GcdMatrix& other) const {
+		return { m00 * other.m00 + m01 * other.m10, m00 * other.m01 + m01 * other.m11,
+			m10 * other.m00 + m11 * other.m10, m10 * other.m01 + m11 * other.m11 };
+	}
+};
+
+namespace {
+
+// Lehmer 的余因子（Knuth 算法 L）：x >= y 是两个数同一位置截断后的高位，
+// 商 (x + m[0]) / (y + m[2]) 与 (x + m[1]) / (y + m[3]) 相同时真实的商也相同。
+// 系数限制在 31 位以内，使 limb::lehmerUpdate 不会溢出；一步也不能确定时返回 false
+bool lehmerCofactors(int64_t x, int64_t y, int64_t (&m)[4]) {
+	constexpr int64_t LIMIT = std::numeric_limits<int32_t>::max();
+	int64_t a = 1, b = 0, c = 0, d = 1;
+	while (y + c > 0 && y + d > 0) {
+		const int64_t q = (x + a) / (y + c);
+		if (q != (x + b) / (y + d) || q > LIMIT) {
+			break;
 		}
+		const int64_t nextC = a - q * c;
+		const int64_t nextD = b - q * d;
+		if (nextC > LIMIT || nextC < -LIMIT || nextD > LIMIT || nextD < -LIMIT) {
+			break;
+		}
+		a = c;
+		b = d;
+		c = nextC;
+		d = nextD;
+		const int64_t r = x - q * y;
+		x = y;
+		y = r;
+	}
 
-		return ret;
+	m[0] = a;
+	m[1] = b;
+	m[2] = c;
+	m[3] = d;
+	return b != 0;
+}
+
+// (u, v) -> (x0 u + y0 v, x1 u + y1 v)
+void transformPair(BigInteger& u, BigInteger& v, int64_t x0, int64_t y0, int64_t x1, int64_t y1) {
+	BigInteger nextU = u * x0 + v * y0;
+	v = u * x1 + v * y1;
+	u = std::move(nextU);
+}
+
+} // namespace
+
+void BigInteger::gcdStep(BigInteger& a, BigInteger& b, GcdMatrix* matrix, BigInteger* cofactors) {
+	// 两个数在同一位置截断，保留 a 的最高两块
+	const size_t n = a.digits.size();
+	const auto leading = [n](const BigInteger& v) {
+		int64_t x = 0;
+		for (size_t i = n; i-- > (n >= 2 ? n - 2 : 0);) {
+			x = x * BASE + (i < v.digits.size() ? v.digits[i] : 0);
+		}
+		return x;
 	};
 
-	if (isDivBy235(divisor)) {
-		return false;
+	int64_t m[4];
+	if (lehmerCofactors(leading(a), leading(b), m)) {
+		b.digits.resize(n, 0);
+		limb::lehmerUpdate(a.digits.data(), b.digits.data(), n, m[0], m[1], m[2], m[3]);
+		a.removeLeadingZeros();
+		b.removeLeadingZeros();
+		if (matrix) {
+			transformPair(matrix->m00, matrix->m10, m[0], m[1], m[2], m[3]);
+			transformPair(matrix->m01, matrix->m11, m[0], m[1], m[2], m[3]);
+		}
+		if (cofactors) {
+			transformPair(cofactors[0], cofactors[1], m[0], m[1], m[2], m[3]);
+		}
+		return;
 	}
 
-#if 1
-	// 尝试加载素数文件
-	if (!sPrimes) { // 仅在首次调用时加载
-		size_t file_size = 0;
-#ifdef _WIN32
-		sPrimes = static_cast<uint32_t*>(sMemFile.loadFile(L"primes.dat", file_size));
-#else 
-		sPrimes = static_cast<uint32_t*>(sMemFile.loadFile("primes.dat", file_size));
-#endif
-		if (sPrimes) {
-			primeCount = file_size / sizeof(uint32_t);
+	// 商太大或近似不够时做一次带余除法
+	auto [q, r] = a.innerDiv(b);
+	a = std::move(b);
+	b = std::move(r);
+	const auto divide = [&q](BigInteger& u, BigInteger& v) {
+		BigInteger next = u - q * v;
+		u = std::move(v);
+		v = std::move(next);
+	};
+	if (matrix) {
+		divide(matrix->m00, matrix->m10);
+		divide(matrix->m01, matrix->m11);
+	}
+	if (cofactors) {
+		divide(cofactors[0], cofactors[1]);
+	}
+}
+
+void BigInteger::applyGcdMatrix(GcdMatrix& matrix, BigInteger& a, BigInteger& b) {
+	BigInteger x = matrix.m00 * a + matrix.m01 * b;
+	BigInteger y = matrix.m10 * a + matrix.m11 * b;
+	// 高位部分的最后几个商可能不适用于整个数，取反或交换两行仍是行列式为 ±1 的变换
+	if (x.isNegative) {
+		x.negate();
+		matrix.m00.negate();
+		matrix.m01.negate();
+	}
+	if (y.isNegative) {
+		y.negate();
+		matrix.m10.negate();
+		matrix.m11.negate();
+	}
+	if (x < y) {
+		std::swap(x, y);
+		std::swap(matrix.m00, matrix.m10);
+		std::swap(matrix.m01, matrix.m11);
+	}
+	a = std::move(x);
+	b = std::move(y);
+}
+
+BigInteger::GcdMatrix BigInteger::halfGcd(BigInteger& a, BigInteger& b) {
+	GcdMatrix matrix;
+	const size_t n = a.digits.size();
+	const size_t target = n / 2 + 1;
+	if (n >= GCD_HALF_THRESHOLD && b.digits.size() > target) {
+		// 高一半约化到原来的一半，整个数约化掉约 n / 4 块
+		const size_t low = n / 2;
+		BigInteger highA = a.slice(low, n - low);
+		BigInteger highB = b.slice(low, n - low);
+		matrix = halfGcd(highA, highB);
+		applyGcdMatrix(matrix, a, b);
+
+		// 剩下要约化的块数为 a 的长度减去 target，取两倍于此的高位再递归一次
+		const size_t length = a.digits.size();
+		if (b.digits.size() > target && 2 * target > length && 2 * (length - target) >= GCD_HALF_THRESHOLD) {
+			const size_t from = 2 * target - length;
+			highA = a.slice(from, length - from);
+			highB = b.slice(from, length - from);
+			GcdMatrix second = halfGcd(highA, highB);
+			applyGcdMatrix(second, a, b);
+			matrix = second * matrix;
 		}
 	}
-	// 使用素数文件进行快速判断
-	if (sPrimes) {
-		if (*this < std::numeric_limits<uint32_t>::max()
-			&& std::ranges::binary_search(sPrimes, sPrimes + primeCount, *this)) {
-			return true;
+
+	while (b.digits.size() > target) {
+		gcdStep(a, b, &matrix, nullptr);
+	}
+	return matrix;
+}
+
+BigInteger BigInteger::gcdReduce(BigInteger a, BigInteger b, BigInteger* cofactors) {
+	if (a < b) {
+		std::swap(a, b);
+		if (cofactors) {
+			std::swap(cofactors[0], cofactors[1]);
+		}
+	}
+
+	while (!b.isZero()) {
+		uint64_t x = 0;
+		uint64_t y = 0;
+		if (!cofactors && a.fitsUint64(x) && b.fitsUint64(y)) {
+			return BigInteger(std::gcd(x, y));
+		}
+
+		// 长度相近的长数用半 GCD 约化高位 2/3，每次约掉约 1/3 的块
+		const size_t n = a.digits.size();
+		if (b.digits.size() >= GCD_HALF_THRESHOLD && n - b.digits.size() <= n / 8) {
+			const size_t low = n / 3;
+			BigInteger highA = a.slice(low, n - low);
+			BigInteger highB = b.slice(low, n - low);
+			GcdMatrix matrix = halfGcd(highA, highB);
+			applyGcdMatrix(matrix, a, b);
+			if (cofactors) {
+				BigInteger u = matrix.m00 * cofactors[0] + matrix.m01 * cofactors[1];
+				cofactors[1] = matrix.m10 * cofactors[0] + matrix.m11 * cofactors[1];
+				cofactors[0] = std::move(u);
+			}
+			if (b.isZero()) {
+				break;
+			}
+		}
+		gcdStep(a, b, nullptr, cofactors);
+	}
+	return a;
+}
+
+BigInteger BigInteger::gcd(const BigInteger& a, const BigInteger& b) {
+	BigInteger x = a;
+	BigInteger y = b;
+	x.isNegative = false;
+	y.isNegative = false;
+	return gcdReduce(std::move(x), std::move(y), nullptr);
+}
+
+BigInteger BigInteger::lcm(const BigInteger& a, const BigInteger& b) {
+	if (a.isZero() || b.isZero()) {
+		return BigInteger();
+	}
+	BigInteger result = a / gcd(a, b) * b;
+	result.isNegative = false;
+	return result;
+}
+
+std::tuple<BigInteger, BigInteger, BigInteger> BigInteger::extendedGcd(const BigInteger& a, const BigInteger& b) {
+	BigInteger x = a;
+	BigInteger y = b;
+	x.isNegative = false;
+	y.isNegative = false;
+
+	// 只跟踪 a 的系数：约化过程中的每个数都等于 |a| * cofactors[i] + |b| * (某个整数)
+	BigInteger cofactors[2] = { 1, 0 };
+	BigInteger g = gcdReduce(x, y, cofactors);
+	BigInteger s = std::move(cofactors[0]);
+	BigInteger t;
+	if (y.isZero()) {
+		s = x.isZero() ? 0 : 1;
+	}
+	else {
+		// 把 s 规范到 [0, |b| / g)，再由 |a| * s + |b| * t = g 求出 t
+		const BigInteger period = y / g;
+		s %= period;
+		if (s.isNegative) {
+			s += period;
+		}
+		t = (g - x * s) / y;
+	}
+
+	if (a.isNegative) {
+		s.negate();
+	}
+	if (b.isNegative) {
+		t.negate();
+	}
+	return { std::move(g), std::move(s), std::move(t) };
+}
+
+BigInteger BigInteger::modInverse(const BigInteger& modulus) const {
+	if (modulus.isNegative || modulus.isZero()) {
+		throw std::invalid_argument("modulus must be positive");
+	}
+
+	BigInteger value = *this % modulus;
+	if (value.isNegative) {
+		value += modulus;
+	}
+	BigInteger cofactors[2] = { 1, 0 };
+	if (gcdReduce(std::move(value), modulus, cofactors) != 1) {
+		throw std::invalid_argument("value is not invertible modulo modulus");
+	}
+
+	BigInteger inverse = cofactors[0] % modulus;
+	if (inverse.isNegative) {
+		inverse += modulus;
+	}
+	return inverse;
+}
+
+namespace {
+
+// 模 n 加减，操作数在 [0, n) 内
+BigInteger addMod(const BigInteger& a, const BigInteger& b, const BigInteger& n) {
+	BigInteger r = a + b;
+	if (r >= n) {
+		r -= n;
+	}
+	return r;
+}
+
+BigInteger subMod(const BigInteger& a, const BigInteger& b, const BigInteger& n) {
+	BigInteger r = a - b;
+	if (r < 0) {
+		r += n;
+	}
+	return r;
+}
+
+// Montgomery 曲线 By^2 = x^3 + Ax^2 + x 上的射影点 (X : Z)，只用 x 坐标，坐标都是 Montgomery 形式
+struct CurvePoint {
+	BigInteger x;
+	BigInteger z;
+};
+
+// 2P，a24 / c24 = (A + 2) / 4
+CurvePoint xDouble(const MontgomeryContext& context, const CurvePoint& p, const BigInteger& a24, const BigInteger& c24) {
+	const BigInteger& n = context.modulus();
+	const BigInteger sum = context.square(addMod(p.x, p.z, n));
+	const BigInteger diff = context.square(subMod(p.x, p.z, n));
+	// cross = 4XZ
+	const BigInteger cross = subMod(sum, diff, n);
+	const BigInteger t = context.multiply(c24, diff);
+	return { context.multiply(t, sum), context.multiply(addMod(t, context.multiply(a24, cross), n), cross) };
+}
+
+// P + Q，已知 P - Q
+CurvePoint xAdd(const MontgomeryContext& context, const CurvePoint& p, const CurvePoint& q, const CurvePoint& difference) {
+	const BigInteger& n = context.modulus();
+	const BigInteger u = context.multiply(subMod(p.x, p.z, n), addMod(q.x, q.z, n));
+	const BigInteger v = context.multiply(addMod(p.x, p.z, n), subMod(q.x, q.z, n));
+	return { context.multiply(difference.z, context.square(addMod(u, v, n))),
+		context.multiply(difference.x, context.square(subMod(u, v, n))) };
+}
+
+// [k]P，k >= 1，蒙哥马利阶梯
+CurvePoint xMultiply(const MontgomeryContext& context, const CurvePoint& p, uint64_t k, const BigInteger& a24, const BigInteger& c24) {
+	CurvePoint r0 = p;
+	CurvePoint r1 = xDouble(context, p, a24, c24);
+	for (int i = std::bit_width(k) - 2; i >= 0; --i) {
+		if ((k >> i) & 1) {
+			r0 = xAdd(context, r1, r0, p);
+			r1 = xDouble(context, r1, a24, c24);
+		}
+		else {
+			r1 = xAdd(context, r1, r0, p);
+			r0 = xDouble(context, r0, a24, c24);
 		}
+	}
+	return r0;
+}
 
-		for (size_t i = 0; i < primeCount; ++i) {
-			BigInteger x = sPrimes[i];
-			auto [quotient, remainder] = this->innerDiv(x);
-			if (remainder == 0) {
-				divisor = x;
-				return false;
+// ECM 的参数：每级的阶段 1 上界和曲线数（大致能找到 15、20、25、30、35、40 位的因子），阶段 2 上界为 B1 的 50 倍
+struct EcmLevel {
+	uint32_t b1;
+	int curves;
+};
+constexpr EcmLevel ECM_LEVELS[] = {
+	{ 2000, 25 }, { 11000, 90 }, { 50000, 300 }, { 250000, 700 }, { 1000000, 1800 }, { 3000000, 5100 },
+};
+constexpr uint32_t ECM_B2_FACTOR = 50;
+// 阶段 2 大步的步长，小步只需覆盖 D / 2 以内的奇数
+constexpr uint32_t ECM_STAGE2_STEP = 2310;
+
+} // namespace
+
+BigInteger BigInteger::pollardBrent(const BigInteger& n, uint64_t iterations, std::mt19937_64& engine,
+	std::chrono::steady_clock::time_point deadline) {
+	// 在 Montgomery 形式下迭代 y -> y^2 + c，gcd(x - y, n) 不受 R 的影响
+	const MontgomeryContext context(n);
+	// 每批累乘 BATCH 个差再求一次最大公约数
+	constexpr uint64_t BATCH = 128;
+	uint64_t used = 0;
+	while (used < iterations && std::chrono::steady_clock::now() < deadline) {
+		const BigInteger c = context.toMontgomery(engine());
+		auto next = [&](const BigInteger& y) { return addMod(context.square(y), c, n); };
+
+		BigInteger y = context.toMontgomery(engine());
+		BigInteger x, ys;
+		BigInteger q = context.one();
+		BigInteger g = 1;
+		for (uint64_t r = 1; g == 1u && used < iterations; r *= 2) {
+			x = y;
+			for (uint64_t i = 0; i < r; ++i) {
+				y = next(y);
 			}
-			if (quotient <= x) {
+			for (uint64_t k = 0; k < r && g == 1u; k += BATCH) {
+				ys = y;
+				for (uint64_t i = 0; i < std::min(BATCH, r - k); ++i) {
+					y = next(y);
+					q = context.multiply(q, subMod(x, y, n));
+				}
+				g = gcd(q, n);
+			}
+			used += 2 * r;
+			if (std::chrono::steady_clock::now() >= deadline) {
 				break;
 			}
+		}
 
-			
+		if (g == n) {
+			// 这一批里累乘到了 0，从批首逐个重算
+			do {
+				ys = next(ys);
+				g = gcd(subMod(x, ys, n), n);
+			} while (g == 1u);
 		}
+		if (g != 1u && g != n) {
+			return g;
+		}
+		// 失败时换一个 c 重新开始
+	}
+
+	return 0;
+}
 
-		uint32_t last_prime = sPrimes[primeCount - 1];
+BigInteger BigInteger::ecmCurve(const MontgomeryContext& context, uint64_t sigma, uint32_t b1, const std::vector<uint32_t>& primes) {
+	const BigInteger& n = context.modulus();
+
+	// Suyama 参数化：u = sigma^2 - 5，v = 4 sigma，起点 (u^3 : v^3)，(A + 2) / 4 = (v - u)^3 (3u + v) / (16 u^3 v)
+	const BigInteger s = context.toMontgomery(sigma);
+	const BigInteger u = subMod(context.square(s), context.toMontgomery(5), n);
+	const BigInteger v = addMod(addMod(s, s, n), addMod(s, s, n), n);
+	const BigInteger u3 = context.multiply(context.square(u), u);
+	CurvePoint p{ u3, context.multiply(context.square(v), v) };
+	const BigInteger vu = subMod(v, u, n);
+	const BigInteger a24 = context.multiply(context.multiply(context.square(vu), vu), addMod(addMod(u, addMod(u, u, n), n), v, n));
+	const BigInteger c24 = context.multiply(u3, v) * 16u % n;
+	BigInteger g = gcd(c24, n);
+	if (g != 1u) {
+		return g == n ? BigInteger(0) : g;
+	}
 
-		int v = (last_prime - 7) % 30;
-		int step_index = 0;
-		while (v > 0) {
-			v -= STEP[step_index];
-			++step_index;
-			step_index %= STEP_COUNT;
+	// 阶段 1：乘以不超过 b1 的所有素数幂
+	auto it = primes.begin();
+	for (; it != primes.end() && *it <= b1; ++it) {
+		uint64_t q = *it;
+		while (q * *it <= b1) {
+			q *= *it;
 		}
+		p = xMultiply(context, p, q, a24, c24);
+	}
+	g = gcd(p.z, n);
+	if (g != 1u || it == primes.end()) {
+		return g == n || g == 1u ? BigInteger(0) : g;
+	}
 
-		BigInteger start = last_prime;
-		return checkPrimeWithStep(divisor, start);
+	// 阶段 2：素数 q = mD ± j，[q]P 为无穷远点当且仅当 [mD]P 与 [j]P 的 x 坐标相同，
+	// 累乘 X_mD Z_j - X_j Z_mD 后求一次最大公约数
+	constexpr uint32_t D = ECM_STAGE2_STEP;
+	std::vector<CurvePoint> baby(D / 2 + 1);
+	const CurvePoint p2 = xDouble(context, p, a24, c24);
+	baby[1] = p;
+	baby[3] = xAdd(context, p2, p, p);
+	for (uint32_t j = 5; j <= D / 2; j += 2) {
+		baby[j] = xAdd(context, baby[j - 2], p2, baby[j - 4]);
 	}
-#endif
-	// 素数文件加载失败，从 7 开始判断   
-	BigInteger start = 7;
-	return checkPrimeWithStep(divisor, start);
+
+	const CurvePoint step = xMultiply(context, p, D, a24, c24);
+	uint64_t m = std::max<uint64_t>(1, (*it + D / 2) / D);
+	CurvePoint giant = xMultiply(context, p, m * D, a24, c24);
+	CurvePoint next = xMultiply(context, p, (m + 1) * D, a24, c24);
+	BigInteger product = context.one();
+	for (; it != primes.end(); ++it) {
+		const uint64_t target = (*it + D / 2) / D;
+		while (m < target) {
+			CurvePoint after = xAdd(context, next, step, giant);
+			giant = std::move(next);
+			next = std::move(after);
+			++m;
+		}
+		const uint64_t center = m * D;
+		const uint64_t j = *it > center ? *it - center : center - *it;
+		product = context.multiply(product, subMod(context.multiply(giant.x, baby[j].z), context.multiply(baby[j].x, giant.z), n));
+	}
+	g = gcd(product, n);
+	return g == n || g == 1u ? BigInteger(0) : g;
 }
 
-BigInteger BigInteger::fibonacci(int64_t n) {
-	if (n == 0) return BigInteger(0);
-	if (n == 1) return BigInteger(1);
+BigInteger BigInteger::findFactor(const BigInteger& n, const FactorOptions& options, std::mt19937_64& engine,
+	std::chrono::steady_clock::time_point deadline) {
+	BigInteger d = pollardBrent(n, options.rhoIterations, engine, deadline);
+	if (d != 0u) {
+		return d;
+	}
+
+	const MontgomeryContext context(n);
+	std::vector<uint32_t> primes;
+	uint32_t sievedBound = 0;
+	size_t level = 0;
+	int levelCurves = 0;
+	for (int curves = 0; options.ecmCurves == 0 || curves < options.ecmCurves; ++curves) {
+		if (std::chrono::steady_clock::now() >= deadline) {
+			break;
+		}
+		const uint32_t b1 = ECM_LEVELS[level].b1;
+		if (sievedBound != b1 * ECM_B2_FACTOR) {
+			sievedBound = b1 * ECM_B2_FACTOR;
+			primes = sievePrimes(sievedBound);
+		}
+		d = ecmCurve(context, 6 + (engine() >> 32), b1, primes);
+		if (d != 0u) {
+			return d;
+		}
+		if (++levelCurves == ECM_LEVELS[level].curves && level + 1 < std::size(ECM_LEVELS)) {
+			++level;
+			levelCurves = 0;
+		}
+	}
 
-	Matrix base;
-	base.data[0][0] = BigInteger(1);
-	base.data[0][1] = BigInteger(1);
-	base.data[1][0] = BigInteger(1);
-	base.data[1][1] = BigInteger(0);
+	return 0;
+}
 
-	Matrix result = base.fastPower(n - 1);
-	return result.data[0][0];
+std::vector<BigInteger> BigInteger::factor() const {
+	BigInteger cofactor;
+	return factor(FactorOptions{}, cofactor);
 }
 
-BigInteger BigInteger::factorial(int64_t n) {
-	if (n < 0) {
-		throw std::invalid_argument("Factorial is not defined for negative numbers.");
+std::vector<BigInteger> BigInteger::factor(const FactorOptions& options, BigInteger& cofactor) const {
+	std::vector<BigInteger> factors;
+	cofactor = 1;
+	BigInteger n = *this;
+	n.isNegative = false;
+	if (n < 2u) {
+		return factors;
+	}
+
+	// 试除：先除尽 2、3、5，再用素数表，超出表的部分用 mod 30 轮
+	static const uint32_t SMALL_PRIMES[] = { 2, 3, 5 };
+	bool done = n.removeFactors(SMALL_PRIMES, std::size(SMALL_PRIMES), factors);
+	if (!done && loadPrimeTable()) {
+		const size_t count = sPrimeTable.upperBound(options.trialBound);
+		std::vector<uint32_t> candidates(std::min(count, TRIAL_DIVISION_CHUNK));
+		for (size_t index = 0; !done && index < count; index += candidates.size()) {
+			const size_t decoded = sPrimeTable.decode(index, std::min(candidates.size(), count - index), candidates.data());
+			done = n.removeFactors(candidates.data(), decoded, factors);
+		}
+		if (!done && count == sPrimeTable.size() && options.trialBound > sPrimeTable.back()) {
+			done = n.removeWheelFactors(sPrimeTable.back(), wheelStepIndex(sPrimeTable.back()), options.trialBound, factors);
+		}
+	}
+	else if (!done) {
+		done = n.removeWheelFactors(7, 0, options.trialBound, factors);
+	}
+
+	// 剩余的因子都大于试除上界，逐个判定素性或拆分
+	const auto deadline = options.timeLimit.count() > 0
+		? std::chrono::steady_clock::now() + options.timeLimit : std::chrono::steady_clock::time_point::max();
+	const uint64_t provenBound = static_cast<uint64_t>(std::max(options.trialBound, 5u)) * std::max(options.trialBound, 5u);
+	std::mt19937_64 engine(n.digits[0] ^ (static_cast<uint64_t>(n.digits.back()) << 32) ^ n.digits.size());
+	std::vector<BigInteger> pending;
+	if (!done) {
+		pending.push_back(std::move(n));
+	}
+	while (!pending.empty()) {
+		BigInteger c = std::move(pending.back());
+		pending.pop_back();
+		if (c.compareAbsolute(provenBound) < 0 || (c.isStrongProbablePrime(2) && c.isStrongLucasProbablePrime())) {
+			factors.push_back(std::move(c));
+			continue;
+		}
+
+		BigInteger root = c.isqrt();
+		if (root.square() == c) {
+			pending.push_back(root);
+			pending.push_back(std::move(root));
+			continue;
+		}
+
+		BigInteger d = findFactor(c, options, engine, deadline);
+		if (d == 0u) {
+			cofactor *= c;
+			continue;
+		}
+		pending.push_back(c / d);
+		pending.push_back(std::move(d));
+	}
+
+	std::sort(factors.begin(), factors.end());
+	return factors;
+}
+
+namespace {
+
+// "00" ~ "99" 的两位数字表
+constexpr char DIGIT_PAIRS[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+// 把 [0, 10^9) 内的值固定写成 9 位（含前导零），没有分支
+inline void writeNineDigits(char* out, uint32_t value) {
+	uint32_t high = value / 1'0000'0000;
+	uint32_t low = value % 1'0000'0000;
+	uint32_t a = low / 1'0000;
+	uint32_t b = low % 1'0000;
+	out[0] = static_cast<char>('0' + high);
+	std::memcpy(out + 1, DIGIT_PAIRS + 2 * (a / 100), 2);
+	std::memcpy(out + 3, DIGIT_PAIRS + 2 * (a % 100), 2);
+	std::memcpy(out + 5, DIGIT_PAIRS + 2 * (b / 100), 2);
+	std::memcpy(out + 7, DIGIT_PAIRS + 2 * (b % 100), 2);
+}
+
+inline size_t countDigits(uint32_t value) {
+	size_t count = 1;
+	while (value >= 10) {
+		value /= 10;
+		++count;
+	}
+
+	return count;
+}
+
+// 最高块不带前导零，写入 count 位
+inline void writeLeadingDigits(char* out, uint32_t value, size_t count) {
+	char buffer[9];
+	writeNineDigits(buffer, value);
+	std::memcpy(out, buffer + 9 - count, count);
+}
+
+} // namespace
+
+size_t BigInteger::decimalSize() const {
+	if (digits.empty()) {
+		return 1;
+	}
+
+	return countDigits(static_cast<uint32_t>(digits.back())) + (digits.size() - 1) * DIGIT_WIDTH;
+}
+
+std::to_chars_result BigInteger::toChars(char* first, char* last) const {
+	const bool negative = isNegative && !isZero();
+	const size_t size = decimalSize() + (negative ? 1 : 0);
+	if (static_cast<size_t>(last - first) < size) {
+		return { last, std::errc::value_too_large };
 	}
 
-	BigInteger result(1);
-	for (int i = 2; i <= n; ++i) {
-		result = result * BigInteger(i);
+	char* out = first;
+	if (negative) {
+		*out++ = '-';
 	}
+	if (digits.empty()) {
+		*out++ = '0';
+		return { out, std::errc() };
+	}
+
+	size_t topCount = countDigits(static_cast<uint32_t>(digits.back()));
+	writeLeadingDigits(out, static_cast<uint32_t>(digits.back()), topCount);
+	out += topCount;
+	for (size_t i = digits.size() - 1; i-- > 0; ) {
+		writeNineDigits(out, static_cast<uint32_t>(digits[i]));
+		out += DIGIT_WIDTH;
+	}
+
+	return { out, std::errc() };
+}
 
+std::string BigInteger::toString() const {
+	std::string result(decimalSize() + (isNegative && !isZero() ? 1 : 0), '0');
+	toChars(result.data(), result.data() + result.size());
 	return result;
 }
 
 BIGINTEGER_DLL_API std::ostream& operator<<(std::ostream& os, const BigInteger& num) {
+	// 设置了宽度时按格式化字符串输出，保证填充和对齐生效
+	if (os.width() > 0) {
+		return os << num.toString();
+	}
+
 	// 处理负号（零值不输出负号）
 	if (num.isNegative && !num.isZero()) {
-		os << '-';
+		os.put('-');
 	}
 
 	// 处理空 digits（零值）
 	if (num.digits.empty()) {
-		return os << '0';
+		return os.put('0');
 	}
 
-	auto it = num.digits.rbegin();
-	os << *it;
-	for (++it; it != num.digits.rend(); ++it) {
-		os << std::setw(BigInteger::DIGIT_WIDTH) << std::setfill('0') << *it;
+	// 分块格式化到缓冲区，缓冲区满了再整块写入流
+	constexpr size_t CHUNK_SIZE = 16 * 1024;
+	char buffer[CHUNK_SIZE];
+	size_t used = countDigits(static_cast<uint32_t>(num.digits.back()));
+	writeLeadingDigits(buffer, static_cast<uint32_t>(num.digits.back()), used);
+	for (size_t i = num.digits.size() - 1; i-- > 0; ) {
+		if (used + BigInteger::DIGIT_WIDTH > CHUNK_SIZE) {
+			os.write(buffer, used);
+			used = 0;
+		}
+		writeNineDigits(buffer + used, static_cast<uint32_t>(num.digits[i]));
+		used += BigInteger::DIGIT_WIDTH;
 	}
+	os.write(buffer, used);
 
 	return os;
 }
 
 BIGINTEGER_DLL_API Matrix::Matrix() {
-	for (int i = 0; i < 2; ++i) {
-		for (int j = 0; j < 2; ++j) {
-			data[i][j] = BigInteger(0);
-		}
-	}
+	// 各元素默认构造即为零
 }
 
 BIGINTEGER_DLL_API Matrix Matrix::operator*(const Matrix& other) const {
@@ -601,7 +2622,7 @@ BIGINTEGER_DLL_API Matrix Matrix::operator*(const Matrix& other) const {
 	for (int i = 0; i < 2; ++i) {
 		for (int j = 0; j < 2; ++j) {
 			for (int k = 0; k < 2; ++k) {
-				result.data[i][j] = result.data[i][j] + data[i][k] * other.data[k][j];
+				result.data[i][j] += data[i][k] * other.data[k][j];
 			}
 		}
 	}
@@ -609,7 +2630,9 @@ BIGINTEGER_DLL_API Matrix Matrix::operator*(const Matrix& other) const {
 	return result;
 }
 
-BIGINTEGER_DLL_API Matrix Matrix::fastPower(int n) const {
+BIGINTEGER_DLL_API Matrix Matrix::fastPower(int64_t n) const {
+	// 整个幂运算共用一个临时缓冲区的作用域，各次乘法之间不交还分段
+	ScratchArena::Scope scope;
 	Matrix result;
 	result.data[0][0] = BigInteger(1);
 	result.data[1][1] = BigInteger(1);
@@ -627,103 +2650,166 @@ BIGINTEGER_DLL_API Matrix Matrix::fastPower(int n) const {
 
 using std::operator""s;
 
-BIGINTEGER_DLL_API BigInteger operator"" _bi(const char* str, size_t len) {
-	// 检查合法性：分隔符不能出现在首尾，且不能连续出现
-	if (len > 0) {
-		if (str[0] == '\'' || str[len - 1] == '\'') {
-			throw std::invalid_argument("BigInteger字面量首尾不能使用分隔符");
-		}
-
-		for (size_t i = 0; i < len - 1; i++) {
-			if (str[i] == '\'' && str[i + 1] == '\'') {
-				throw std::invalid_argument("BigInteger字面量不能包含连续的分隔符");
-			}
-		}
-	}
+namespace {
 
-	// 移除所有分隔符并处理符号
-	std::string cleanStr;
-	bool isNegative = false;
-	bool hasSign = false;
-	bool hasNonSignChar = false;  // 标记是否已出现非符号字符
+constexpr int32_t POW10[] = { 1, 10, 100, 1000, 1'0000, 10'0000, 100'0000, 1000'0000, 1'0000'0000 };
 
-	for (size_t i = 0; i < len; ++i) {
-		if (str[i] == '\'') continue;
-
-		// 检查是否为符号位
-		if (!hasSign && (str[i] == '+' || str[i] == '-')) {
-			// 符号位必须是第一个有效字符（不能在非符号字符之后）
-			if (hasNonSignChar) {
-				throw std::invalid_argument("符号位只能出现在首位");
-			}
+inline bool isDecimalDigit(int c) {
+	return c >= '0' && c <= '9';
+}
 
-			hasSign = true;
-			if (str[i] == '-') isNegative = true;
-			continue;
+// 读入时按 9 位一组从高位开始切分，tail 为最后不满 9 位的 tailSize 位。
+// 按总位数原地重新对齐成从低位开始切分的块，并转换为低位在前
+template <typename Groups>
+void alignDigitGroups(Groups& groups, int32_t tail, int tailSize) {
+	if (tailSize > 0) {
+		const int32_t low = POW10[tailSize];
+		const int32_t high = POW10[9 - tailSize];
+		int32_t prev = 0;
+		for (int32_t& group : groups) {
+			int32_t value = group;
+			group = prev * low + value / high;
+			prev = value % high;
 		}
+		groups.push_back(prev * low + tail);
+	}
+	std::reverse(groups.begin(), groups.end());
+}
 
-		// 标记已出现非符号字符
-		hasNonSignChar = true;
+} // namespace
+
+BigInteger BigInteger::fromChars(std::string_view str) {
+	// 检查合法性：分隔符不能出现在首尾，且不能连续出现
+	if (str.empty()) {
+		throw std::invalid_argument("BigInteger字符串不能为空");
+	}
+	if (str.front() == '\'' || str.back() == '\'') {
+		throw std::invalid_argument("BigInteger字面量首尾不能使用分隔符");
+	}
 
-		// 确保符号后紧跟数字
-		if (hasSign && cleanStr.empty() && !std::isdigit(str[i])) {
+	bool negative = false;
+	size_t pos = 0;
+	if (str[0] == '+' || str[0] == '-') {
+		negative = str[0] == '-';
+		pos = 1;
+		if (pos == str.size() || !isDecimalDigit(str[pos])) {
 			throw std::invalid_argument("符号后必须紧跟数字");
 		}
+	}
 
-		if (!std::isdigit(str[i])) {
+	// 第一遍：检查字符并统计数字位数
+	size_t digitCount = 0;
+	for (size_t i = pos; i < str.size(); ++i) {
+		const char c = str[i];
+		if (isDecimalDigit(c)) {
+			++digitCount;
+		}
+		else if (c == '\'') {
+			if (str[i + 1] == '\'') {
+				throw std::invalid_argument("BigInteger字面量不能包含连续的分隔符");
+			}
+		}
+		else if (c == '+' || c == '-') {
+			throw std::invalid_argument("符号位只能出现在首位");
+		}
+		else {
 			throw std::invalid_argument("BigInteger字面量包含非法字符");
 		}
-
-		cleanStr += str[i];
 	}
 
-	// 处理空字符串或全零
-	if (cleanStr.empty() || cleanStr == "0") {
-		return BigInteger({0}, false);  // 零值
+	// 第二遍：从高位开始直接累加到块中，最高块只有 digitCount % 9 位
+	Digits limbs((digitCount + DIGIT_WIDTH - 1) / DIGIT_WIDTH);
+	size_t index = limbs.size();
+	int groupLeft = static_cast<int>(digitCount % DIGIT_WIDTH);
+	if (groupLeft == 0) {
+		groupLeft = DIGIT_WIDTH;
 	}
+	int32_t value = 0;
+	for (size_t i = pos; i < str.size(); ++i) {
+		const char c = str[i];
+		if (c == '\'') {
+			continue;
+		}
 
-	// 移除前导零
-	size_t firstNonZero = cleanStr.find_first_not_of('0');
-	if (firstNonZero != std::string::npos) {
-		cleanStr = cleanStr.substr(firstNonZero);
-	}
-	else {
-		cleanStr = "0"; // 如果全是零，设置为 "0"
+		value = value * 10 + (c - '0');
+		if (--groupLeft == 0) {
+			limbs[--index] = value;
+			value = 0;
+			groupLeft = DIGIT_WIDTH;
+		}
 	}
 
-	// 直接构造 digits 向量（低位在前）
-	std::vector<int32_t> digits;
+	return BigInteger(std::move(limbs), negative);
+}
 
-	// 从低位到高位，按每 9 位一组处理
-	for (size_t i = cleanStr.length(); i > 0; ) {
-		// 计算当前组的起始位置（确保不越界）
-		size_t start = (i >= BigInteger::DIGIT_WIDTH) ? (i - BigInteger::DIGIT_WIDTH) : 0;
+BIGINTEGER_DLL_API std::istream& operator>>(std::istream& is, BigInteger& num) {
+	std::istream::sentry sentry(is);
+	if (!sentry) {
+		return is;
+	}
 
-		// 计算当前组的长度（确保不越界）
-		size_t length = i - start;
+	// 直接从流缓冲区逐字符读取，数字按 9 位一组累加，不为每组分配内存
+	std::streambuf* buf = is.rdbuf();
+	std::ios_base::iostate state = std::ios_base::goodbit;
+	bool negative = false;
+	int c = buf->sgetc();
+	if (c == '+' || c == '-') {
+		negative = c == '-';
+		c = buf->snextc();
+	}
 
-		// 安全检查：确保 start 和 length 有效
-		if (start > cleanStr.length() || length == 0) {
-			throw std::out_of_range("Invalid substring range");
+	BigInteger::Digits groups;
+	int32_t value = 0;
+	int groupSize = 0;
+	bool hasDigit = false;
+	while (true) {
+		if (c == std::char_traits<char>::eof()) {
+			state |= std::ios_base::eofbit;
+			break;
 		}
 
-		std::string group = cleanStr.substr(start, length);
+		if (isDecimalDigit(c)) {
+			hasDigit = true;
+			value = value * 10 + (c - '0');
+			if (++groupSize == BigInteger::DIGIT_WIDTH) {
+				groups.push_back(value);
+				value = 0;
+				groupSize = 0;
+			}
+		}
+		else if (c == '\'' && hasDigit) {
+			// 分隔符必须夹在两个数字之间
+			c = buf->snextc();
+			if (!isDecimalDigit(c)) {
+				state |= std::ios_base::failbit;
+				break;
+			}
+			continue;
+		}
+		else {
+			break;
+		}
 
-		// 使用 stoll 避免溢出，并检查范围
-		long long value = std::stoll(group);
+		c = buf->snextc();
+	}
 
-		// 确保转换结果在 int32_t 范围内
-		if (value < std::numeric_limits<int32_t>::min() ||
-			value > std::numeric_limits<int32_t>::max()) {
-			throw std::overflow_error("Digit group out of int32_t range");
-		}
+	if (!hasDigit) {
+		state |= std::ios_base::failbit;
+	}
+	if (!(state & std::ios_base::failbit)) {
+		alignDigitGroups(groups, value, groupSize);
+		num = BigInteger(std::move(groups), negative);
+	}
 
-		digits.push_back(static_cast<int32_t>(value));
+	is.setstate(state);
+	return is;
+}
 
-		// 更新循环变量（直接跳到下一组）
-		i = start;
+BIGINTEGER_DLL_API BigInteger operator"" _bi(const char* str, size_t len) {
+	// 空字面量视为零
+	if (len == 0) {
+		return BigInteger(0);
 	}
 
-	// 使用私有构造函数直接构造 BigInteger
-	return BigInteger(std::move(digits), isNegative);
-}
\ No newline at end of file
+	return BigInteger::fromChars(std::string_view(str, len));
+}
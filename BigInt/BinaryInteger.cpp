@@ -0,0 +1,769 @@
+﻿#include "BinaryInteger.h"
+#include "SlidingWindowPow.h"
+
+const size_t BinaryInteger::RADIX_THRESHOLD = 32;
+
+namespace {
+
+// 以下为 2^32 进制的块运算，数组低位在前，调用方保证输出缓冲区的长度足够
+// Karatsuba 乘法和平方的阈值（较短操作数的块数）
+constexpr size_t KARATSUBA_THRESHOLD = 32;
+constexpr size_t KARATSUBA_SQR_THRESHOLD = 48;
+
+size_t normalizedSize(const uint32_t* a, size_t n) {
+	while (n > 0 && a[n - 1] == 0) {
+		--n;
+	}
+	return n;
+}
+
+// r[0, na) = a[0, na) + b[0, nb)，要求 na >= nb，返回最高位进位；r 可以与 a 重叠
+uint32_t add(uint32_t* r, const uint32_t* a, size_t na, const uint32_t* b, size_t nb) {
+	uint64_t carry = 0;
+	size_t i = 0;
+	for (; i < nb; ++i) {
+		carry += uint64_t(a[i]) + b[i];
+		r[i] = static_cast<uint32_t>(carry);
+		carry >>= 32;
+	}
+	for (; i < na; ++i) {
+		carry += a[i];
+		r[i] = static_cast<uint32_t>(carry);
+		carry >>= 32;
+	}
+	return static_cast<uint32_t>(carry);
+}
+
+// r[0, na) = a[0, na) - b[0, nb)，要求 na >= nb，返回最高位借位；r 可以与 a 重叠
+uint32_t sub(uint32_t* r, const uint32_t* a, size_t na, const uint32_t* b, size_t nb) {
+	uint64_t borrow = 0;
+	size_t i = 0;
+	for (; i < nb; ++i) {
+		const uint64_t diff = uint64_t(a[i]) - b[i] - borrow;
+		r[i] = static_cast<uint32_t>(diff);
+		borrow = diff >> 63;
+	}
+	for (; i < na; ++i) {
+		const uint64_t diff = uint64_t(a[i]) - borrow;
+		r[i] = static_cast<uint32_t>(diff);
+		borrow = diff >> 63;
+	}
+	return static_cast<uint32_t>(borrow);
+}
+
+// r[0, n) += a[0, n) * m，返回溢出的进位块
+uint32_t addMul(uint32_t* r, const uint32_t* a, size_t n, uint32_t m) {
+	uint64_t carry = 0;
+	for (size_t i = 0; i < n; ++i) {
+		carry += uint64_t(a[i]) * m + r[i];
+		r[i] = static_cast<uint32_t>(carry);
+		carry >>= 32;
+	}
+	return static_cast<uint32_t>(carry);
+}
+
+// r[0, na + nb) = a * b，r 不能与 a、b 重叠
+void mulSchoolbook(uint32_t* r, const uint32_t* a, size_t na, const uint32_t* b, size_t nb) {
+	std::fill(r, r + na + nb, 0u);
+	for (size_t j = 0; j < nb; ++j) {
+		r[na + j] = addMul(r + j, a, na, b[j]);
+	}
+}
+
+// r[0, 2n) = a * a，先算一半的交叉乘积再加倍，最后加上对角线
+void sqrSchoolbook(uint32_t* r, const uint32_t* a, size_t n) {
+	std::fill(r, r + 2 * n, 0u);
+	for (size_t i = 0; i + 1 < n; ++i) {
+		r[i + n] = addMul(r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+	}
+	uint32_t high = 0;
+	for (size_t i = 0; i < 2 * n; ++i) {
+		const uint32_t next = r[i] >> 31;
+		r[i] = (r[i] << 1) | high;
+		high = next;
+	}
+	uint64_t carry = 0;
+	for (size_t i = 0; i < n; ++i) {
+		const uint64_t square = uint64_t(a[i]) * a[i];
+		carry += uint64_t(r[2 * i]) + static_cast<uint32_t>(square);
+		r[2 * i] = static_cast<uint32_t>(carry);
+		carry = (carry >> 32) + (square >> 32) + r[2 * i + 1];
+		r[2 * i + 1] = static_cast<uint32_t>(carry);
+		carry >>= 32;
+	}
+}
+
+void sqr(uint32_t* r, const uint32_t* a, size_t n);
+
+// r[0, na + nb) = a * b，按长度在竖式、Karatsuba 和不平衡分块之间选择，r 不能与 a、b 重叠
+void mul(uint32_t* r, const uint32_t* a, size_t na, const uint32_t* b, size_t nb) {
+	if (na < nb) {
+		std::swap(a, b);
+		std::swap(na, nb);
+	}
+	if (nb < KARATSUBA_THRESHOLD) {
+		mulSchoolbook(r, a, na, b, nb);
+		return;
+	}
+	if (na >= 2 * nb) {
+		// 较长的数按 nb 块分段，每段与 b 相乘后累加
+		std::fill(r, r + na + nb, 0u);
+		ScratchArena::Scope scope;
+		uint32_t* product = ScratchArena::allocate<uint32_t>(2 * nb);
+		for (size_t offset = 0; offset < na; offset += nb) {
+			const size_t length = std::min(nb, na - offset);
+			mul(product, a + offset, length, b, nb);
+			add(r + offset, r + offset, na + nb - offset, product, length + nb);
+		}
+		return;
+	}
+
+	// a = a1 * B^h + a0，b = b1 * B^h + b0，na < 2 nb 保证 b1 非空
+	const size_t h = na / 2;
+	mul(r, a, h, b, h);
+	mul(r + 2 * h, a + h, na - h, b + h, nb - h);
+
+	// (a0 + a1)(b0 + b1) - a0 b0 - a1 b1
+	const size_t sa = na - h + 1, sb = std::max(h, nb - h) + 1;
+	ScratchArena::Scope scope;
+	uint32_t* sum = ScratchArena::allocate<uint32_t>(sa + sb);
+	uint32_t* middle = ScratchArena::allocate<uint32_t>(sa + sb);
+	sum[sa - 1] = add(sum, a + h, na - h, a, h);
+	if (nb - h >= h) {
+		sum[sa + sb - 1] = add(sum + sa, b + h, nb - h, b, h);
+	}
+	else {
+		sum[sa + sb - 1] = add(sum + sa, b, h, b + h, nb - h);
+	}
+	mul(middle, sum, sa, sum + sa, sb);
+	sub(middle, middle, sa + sb, r, 2 * h);
+	sub(middle, middle, sa + sb, r + 2 * h, na + nb - 2 * h);
+	add(r + h, r + h, na + nb - h, middle, normalizedSize(middle, sa + sb));
+}
+
+// r[0, 2n) = a * a，按长度在竖式平方和 Karatsuba 平方之间选择，r 不能与 a 重叠
+void sqr(uint32_t* r, const uint32_t* a, size_t n) {
+	if (n < KARATSUBA_SQR_THRESHOLD) {
+		sqrSchoolbook(r, a, n);
+		return;
+	}
+	const size_t h = n / 2;
+	sqr(r, a, h);
+	sqr(r + 2 * h, a + h, n - h);
+
+	// (a0 + a1)^2 - a0^2 - a1^2
+	const size_t s = n - h + 1;
+	ScratchArena::Scope scope;
+	uint32_t* sum = ScratchArena::allocate<uint32_t>(s);
+	uint32_t* middle = ScratchArena::allocate<uint32_t>(2 * s);
+	sum[s - 1] = add(sum, a + h, n - h, a, h);
+	sqr(middle, sum, s);
+	sub(middle, middle, 2 * s, r, 2 * h);
+	sub(middle, middle, 2 * s, r + 2 * h, 2 * (n - h));
+	add(r + h, r + h, 2 * n - h, middle, normalizedSize(middle, 2 * s));
+}
+
+// a[0, n) /= d（原地），返回余数，要求 d > 0
+uint32_t divSmall(uint32_t* a, size_t n, uint32_t d) {
+	uint64_t rem = 0;
+	for (size_t i = n; i-- > 0;) {
+		const uint64_t cur = (rem << 32) | a[i];
+		a[i] = static_cast<uint32_t>(cur / d);
+		rem = cur % d;
+	}
+	return static_cast<uint32_t>(rem);
+}
+
+// Knuth 算法 D：q[0, nu - nv + 1) = u / v，r[0, nv) = u % v
+// 要求 nu >= nv >= 2 且 v 的最高块不为 0
+void divmod(uint32_t* q, uint32_t* r, const uint32_t* u, size_t nu, const uint32_t* v, size_t nv) {
+	// 规格化：左移使除数最高块的最高位为 1，试商最多偏大 2
+	const int s = std::countl_zero(v[nv - 1]);
+	ScratchArena::Scope scope;
+	uint32_t* vn = ScratchArena::allocate<uint32_t>(nv);
+	uint32_t* un = ScratchArena::allocate<uint32_t>(nu + 1);
+	for (size_t i = nv - 1; i > 0; --i) {
+		vn[i] = (v[i] << s) | (s ? uint32_t(uint64_t(v[i - 1]) >> (32 - s)) : 0);
+	}
+	vn[0] = v[0] << s;
+	un[nu] = s ? uint32_t(uint64_t(u[nu - 1]) >> (32 - s)) : 0;
+	for (size_t i = nu - 1; i > 0; --i) {
+		un[i] = (u[i] << s) | (s ? uint32_t(uint64_t(u[i - 1]) >> (32 - s)) : 0);
+	}
+	un[0] = u[0] << s;
+
+	const uint64_t top = vn[nv - 1], second = vn[nv - 2];
+	for (size_t j = nu - nv + 1; j-- > 0;) {
+		const uint64_t numerator = (uint64_t(un[j + nv]) << 32) | un[j + nv - 1];
+		uint64_t qhat = numerator / top;
+		uint64_t rhat = numerator % top;
+		while (qhat >> 32 || qhat * second > ((rhat << 32) | un[j + nv - 2])) {
+			--qhat;
+			rhat += top;
+			if (rhat >> 32) {
+				break;
+			}
+		}
+
+		// un[j, j + nv] -= qhat * vn
+		uint64_t carry = 0;
+		int64_t diff = 0;
+		for (size_t i = 0; i < nv; ++i) {
+			const uint64_t product = qhat * vn[i];
+			diff = int64_t(un[i + j]) - int64_t(carry) - int64_t(product & 0xFFFFFFFFu);
+			un[i + j] = static_cast<uint32_t>(diff);
+			carry = (product >> 32) - (diff >> 32);
+		}
+		diff = int64_t(un[j + nv]) - int64_t(carry);
+		un[j + nv] = static_cast<uint32_t>(diff);
+
+		// 试商偏大 1，加回一次除数
+		if (diff < 0) {
+			--qhat;
+			un[j + nv] += add(un + j, un + j, nv, vn, nv);
+		}
+		q[j] = static_cast<uint32_t>(qhat);
+	}
+
+	for (size_t i = 0; i + 1 < nv; ++i) {
+		r[i] = (un[i] >> s) | (s ? uint32_t(uint64_t(un[i + 1]) << (32 - s)) : 0);
+	}
+	r[nv - 1] = un[nv - 1] >> s;
+}
+
+// -m^-1 mod 2^32，要求 m 为奇数；牛顿迭代每步有效位数翻倍
+uint32_t negativeInverse(uint32_t m) {
+	uint32_t inverse = m;  // 奇数的平方模 8 余 1，初值已有 3 位
+	for (int i = 0; i < 4; ++i) {
+		inverse *= 2 - m * inverse;
+	}
+	return 0 - inverse;
+}
+
+// Montgomery 约简：t[0, 2n + 1) 原地约简，结果 t * 2^(-32n) mod m 写入 r[0, n)；要求 t < m * 2^(32n)
+void montgomeryReduce(uint32_t* r, uint32_t* t, const uint32_t* m, size_t n, uint32_t mInv) {
+	for (size_t i = 0; i < n; ++i) {
+		uint32_t carry = addMul(t + i, m, n, t[i] * mInv);
+		for (size_t k = i + n; carry != 0; ++k) {
+			const uint64_t sum = uint64_t(t[k]) + carry;
+			t[k] = static_cast<uint32_t>(sum);
+			carry = static_cast<uint32_t>(sum >> 32);
+		}
+	}
+	// 结果小于 2m，超出时减去一次
+	const uint32_t* result = t + n;
+	bool reduce = result[n] != 0;
+	if (!reduce) {
+		size_t i = n;
+		while (i > 0 && result[i - 1] == m[i - 1]) {
+			--i;
+		}
+		reduce = i == 0 || result[i - 1] > m[i - 1];
+	}
+	if (reduce) {
+		sub(r, result, n, m, n);
+	}
+	else {
+		std::copy(result, result + n, r);
+	}
+}
+
+} // namespace
+
+BinaryInteger::BinaryInteger(uint64_t num) {
+	if (num != 0) {
+		limbs.push_back(static_cast<uint32_t>(num));
+		if (num >> 32) {
+			limbs.push_back(static_cast<uint32_t>(num >> 32));
+		}
+	}
+}
+
+BinaryInteger::BinaryInteger(const BigInteger& value) {
+	std::vector<BinaryInteger> powers;
+	*this = fromDecimal(value.digits.data(), value.digits.size(), powers);
+	isNegative = value.isNegative && !isZero();
+}
+
+BigInteger BinaryInteger::toBigInteger() const {
+	std::vector<BigInteger> powers;
+	BigInteger result = toDecimal(limbs.data(), limbs.size(), powers);
+	if (isNegative) {
+		result.negate();
+	}
+	return result;
+}
+
+BigInteger BinaryInteger::toDecimal(const uint32_t* a, size_t n, std::vector<BigInteger>& powers) {
+	n = normalizedSize(a, n);
+	if (n <= RADIX_THRESHOLD) {
+		BigInteger result;
+		for (size_t i = n; i-- > 0;) {
+			result *= uint64_t(1) << 32;
+			result += a[i];
+		}
+		return result;
+	}
+
+	// 低 k 块和高 n - k 块分别转换，k 为小于 n 的最大 2 的幂
+	const size_t level = std::bit_width(n - 1) - 1;
+	const size_t k = size_t(1) << level;
+	if (powers.empty()) {
+		powers.emplace_back(uint64_t(1) << 32);
+	}
+	while (powers.size() <= level) {
+		powers.push_back(powers.back().square());
+	}
+	BigInteger result = toDecimal(a + k, n - k, powers) * powers[level];
+	result += toDecimal(a, k, powers);
+	return result;
+}
+
+BinaryInteger BinaryInteger::fromDecimal(const int32_t* d, size_t n, std::vector<BinaryInteger>& powers) {
+	while (n > 0 && d[n - 1] == 0) {
+		--n;
+	}
+	if (n <= RADIX_THRESHOLD) {
+		Limbs result;
+		for (size_t i = n; i-- > 0;) {
+			uint64_t carry = static_cast<uint32_t>(d[i]);
+			for (uint32_t& limb : result) {
+				carry += uint64_t(limb) * static_cast<uint64_t>(BigInteger::BASE);
+				limb = static_cast<uint32_t>(carry);
+				carry >>= 32;
+			}
+			if (carry != 0) {
+				result.push_back(static_cast<uint32_t>(carry));
+			}
+		}
+		return BinaryInteger(std::move(result), false);
+	}
+
+	const size_t level = std::bit_width(n - 1) - 1;
+	const size_t k = size_t(1) << level;
+	if (powers.empty()) {
+		powers.emplace_back(static_cast<uint64_t>(BigInteger::BASE));
+	}
+	while (powers.size() <= level) {
+		powers.push_back(powers.back().square());
+	}
+	BinaryInteger result = fromDecimal(d + k, n - k, powers) * powers[level];
+	result.addAbsolute(fromDecimal(d, k, powers));
+	return result;
+}
+
+bool BinaryInteger::isZero() const {
+	return limbs.empty();
+}
+
+void BinaryInteger::removeLeadingZeros() {
+	while (!limbs.empty() && limbs.back() == 0) {
+		limbs.pop_back();
+	}
+	if (limbs.empty()) {
+		isNegative = false;
+	}
+}
+
+int BinaryInteger::compareAbsolute(const BinaryInteger& a, const BinaryInteger& b) {
+	if (a.limbs.size() != b.limbs.size()) {
+		return a.limbs.size() < b.limbs.size() ? -1 : 1;
+	}
+	for (size_t i = a.limbs.size(); i-- > 0;) {
+		if (a.limbs[i] != b.limbs[i]) {
+			return a.limbs[i] < b.limbs[i] ? -1 : 1;
+		}
+	}
+	return 0;
+}
+
+void BinaryInteger::addAbsolute(const BinaryInteger& other) {
+	if (limbs.size() < other.limbs.size()) {
+		limbs.resize(other.limbs.size());
+	}
+	const uint32_t carry = add(limbs.data(), limbs.data(), limbs.size(), other.limbs.data(), other.limbs.size());
+	if (carry != 0) {
+		limbs.push_back(carry);
+	}
+}
+
+void BinaryInteger::subAbsolute(const BinaryInteger& other) {
+	if (compareAbsolute(*this, other) >= 0) {
+		sub(limbs.data(), limbs.data(), limbs.size(), other.limbs.data(), other.limbs.size());
+	}
+	else {
+		Limbs result(other.limbs.size());
+		sub(result.data(), other.limbs.data(), other.limbs.size(), limbs.data(), limbs.size());
+		limbs = std::move(result);
+		isNegative = !isNegative;
+	}
+	removeLeadingZeros();
+}
+
+std::strong_ordering BinaryInteger::operator<=>(const BinaryInteger& other) const {
+	if (isNegative != other.isNegative) {
+		return isNegative ? std::strong_ordering::less : std::strong_ordering::greater;
+	}
+	const int cmp = isNegative ? compareAbsolute(other, *this) : compareAbsolute(*this, other);
+	return cmp <=> 0;
+}
+
+bool BinaryInteger::operator==(const BinaryInteger& other) const {
+	return isNegative == other.isNegative && limbs == other.limbs;
+}
+
+BinaryInteger BinaryInteger::operator+() const {
+	return *this;
+}
+
+BinaryInteger BinaryInteger::operator-() const {
+	BinaryInteger result(*this);
+	result.isNegative = !isNegative && !isZero();
+	return result;
+}
+
+BinaryInteger BinaryInteger::operator~() const {
+	BinaryInteger result = -*this;
+	result -= 1;
+	return result;
+}
+
+BinaryInteger& BinaryInteger::operator+=(const BinaryInteger& other) {
+	if (isNegative == other.isNegative) {
+		addAbsolute(other);
+	}
+	else {
+		subAbsolute(other);
+	}
+	return *this;
+}
+
+BinaryInteger& BinaryInteger::operator-=(const BinaryInteger& other) {
+	if (isNegative != other.isNegative) {
+		addAbsolute(other);
+	}
+	else {
+		subAbsolute(other);
+	}
+	return *this;
+}
+
+BinaryInteger& BinaryInteger::operator*=(const BinaryInteger& other) {
+	*this = *this * other;
+	return *this;
+}
+
+BinaryInteger& BinaryInteger::operator/=(const BinaryInteger& other) {
+	*this = *this / other;
+	return *this;
+}
+
+BinaryInteger& BinaryInteger::operator%=(const BinaryInteger& other) {
+	*this = *this % other;
+	return *this;
+}
+
+BinaryInteger BinaryInteger::operator+(const BinaryInteger& other) const {
+	BinaryInteger result(*this);
+	result += other;
+	return result;
+}
+
+BinaryInteger BinaryInteger::operator-(const BinaryInteger& other) const {
+	BinaryInteger result(*this);
+	result -= other;
+	return result;
+}
+
+BinaryInteger BinaryInteger::operator*(const BinaryInteger& other) const {
+	if (isZero() || other.isZero()) {
+		return BinaryInteger();
+	}
+	Limbs product(limbs.size() + other.limbs.size());
+	if (this == &other) {
+		sqr(product.data(), limbs.data(), limbs.size());
+	}
+	else {
+		mul(product.data(), limbs.data(), limbs.size(), other.limbs.data(), other.limbs.size());
+	}
+	return BinaryInteger(std::move(product), isNegative != other.isNegative);
+}
+
+BinaryInteger BinaryInteger::square() const {
+	if (isZero()) {
+		return BinaryInteger();
+	}
+	Limbs product(2 * limbs.size());
+	sqr(product.data(), limbs.data(), limbs.size());
+	return BinaryInteger(std::move(product), false);
+}
+
+std::pair<BinaryInteger, BinaryInteger> BinaryInteger::divideAbsolute(const BinaryInteger& divisor) const {
+	if (divisor.isZero()) {
+		throw std::invalid_argument("Division by zero");
+	}
+	if (compareAbsolute(*this, divisor) < 0) {
+		BinaryInteger remainder(*this);
+		remainder.isNegative = false;
+		return { BinaryInteger(), std::move(remainder) };
+	}
+	if (divisor.limbs.size() == 1) {
+		Limbs quotient(limbs);
+		const uint32_t remainder = divSmall(quotient.data(), quotient.size(), divisor.limbs[0]);
+		return { BinaryInteger(std::move(quotient), false), BinaryInteger(remainder) };
+	}
+	Limbs quotient(limbs.size() - divisor.limbs.size() + 1), remainder(divisor.limbs.size());
+	divmod(quotient.data(), remainder.data(), limbs.data(), limbs.size(), divisor.limbs.data(), divisor.limbs.size());
+	return { BinaryInteger(std::move(quotient), false), BinaryInteger(std::move(remainder), false) };
+}
+
+BinaryInteger BinaryInteger::operator/(const BinaryInteger& other) const {
+	BinaryInteger quotient = divideAbsolute(other).first;
+	quotient.isNegative = isNegative != other.isNegative && !quotient.isZero();
+	return quotient;
+}
+
+BinaryInteger BinaryInteger::operator%(const BinaryInteger& other) const {
+	BinaryInteger remainder = divideAbsolute(other).second;
+	remainder.isNegative = isNegative && !remainder.isZero();
+	return remainder;
+}
+
+BinaryInteger::Limbs BinaryInteger::toTwosComplement(size_t count) const {
+	Limbs words(count);
+	std::copy(limbs.begin(), limbs.end(), words.begin());
+	if (isNegative) {
+		// -x = ~x + 1，|x| 非零，加 1 的进位停在第一个非零块
+		size_t i = 0;
+		for (; words[i] == 0; ++i) {
+		}
+		words[i] = 0 - words[i];
+		for (++i; i < count; ++i) {
+			words[i] = ~words[i];
+		}
+	}
+	return words;
+}
+
+BinaryInteger BinaryInteger::fromTwosComplement(Limbs&& words) {
+	const bool negative = words.back() >> 31;
+	if (negative) {
+		size_t i = 0;
+		for (; i < words.size() && words[i] == 0; ++i) {
+		}
+		if (i < words.size()) {
+			words[i] = 0 - words[i];
+			for (++i; i < words.size(); ++i) {
+				words[i] = ~words[i];
+			}
+		}
+	}
+	return BinaryInteger(std::move(words), negative);
+}
+
+BinaryInteger& BinaryInteger::operator&=(const BinaryInteger& other) {
+	if (!isNegative && !other.isNegative) {
+		// 都非负时结果不超过较短的数，不需要补码
+		limbs.resize(std::min(limbs.size(), other.limbs.size()));
+		for (size_t i = 0; i < limbs.size(); ++i) {
+			limbs[i] &= other.limbs[i];
+		}
+		removeLeadingZeros();
+		return *this;
+	}
+	const size_t count = std::max(limbs.size(), other.limbs.size()) + 1;
+	Limbs words = toTwosComplement(count);
+	const Limbs otherWords = other.toTwosComplement(count);
+	for (size_t i = 0; i < count; ++i) {
+		words[i] &= otherWords[i];
+	}
+	*this = fromTwosComplement(std::move(words));
+	return *this;
+}
+
+BinaryInteger& BinaryInteger::operator|=(const BinaryInteger& other) {
+	const size_t count = std::max(limbs.size(), other.limbs.size()) + 1;
+	Limbs words = toTwosComplement(count);
+	const Limbs otherWords = other.toTwosComplement(count);
+	for (size_t i = 0; i < count; ++i) {
+		words[i] |= otherWords[i];
+	}
+	*this = fromTwosComplement(std::move(words));
+	return *this;
+}
+
+BinaryInteger& BinaryInteger::operator^=(const BinaryInteger& other) {
+	const size_t count = std::max(limbs.size(), other.limbs.size()) + 1;
+	Limbs words = toTwosComplement(count);
+	const Limbs otherWords = other.toTwosComplement(count);
+	for (size_t i = 0; i < count; ++i) {
+		words[i] ^= otherWords[i];
+	}
+	*this = fromTwosComplement(std::move(words));
+	return *this;
+}
+
+BinaryInteger BinaryInteger::operator&(const BinaryInteger& other) const {
+	BinaryInteger result(*this);
+	result &= other;
+	return result;
+}
+
+BinaryInteger BinaryInteger::operator|(const BinaryInteger& other) const {
+	BinaryInteger result(*this);
+	result |= other;
+	return result;
+}
+
+BinaryInteger BinaryInteger::operator^(const BinaryInteger& other) const {
+	BinaryInteger result(*this);
+	result ^= other;
+	return result;
+}
+
+BinaryInteger& BinaryInteger::operator<<=(size_t count) {
+	if (isZero() || count == 0) {
+		return *this;
+	}
+	const size_t whole = count / 32;
+	const int bits = count % 32;
+	const size_t size = limbs.size();
+	limbs.resize(size + whole + 1);
+	for (size_t i = size + 1; i-- > 0;) {
+		const uint32_t high = i < size ? limbs[i] : 0;
+		const uint32_t low = i > 0 ? limbs[i - 1] : 0;
+		limbs[i + whole] = bits ? (high << bits) | (low >> (32 - bits)) : high;
+	}
+	std::fill(limbs.begin(), limbs.begin() + whole, 0u);
+	removeLeadingZeros();
+	return *this;
+}
+
+BinaryInteger& BinaryInteger::operator>>=(size_t count) {
+	if (isNegative) {
+		// floor(x / 2^count) = ~(~x >> count)，~x 非负
+		*this = ~(~*this >> count);
+		return *this;
+	}
+	const size_t whole = count / 32;
+	if (whole >= limbs.size()) {
+		limbs.clear();
+		return *this;
+	}
+	const int bits = count % 32;
+	const size_t size = limbs.size() - whole;
+	for (size_t i = 0; i < size; ++i) {
+		const uint32_t low = limbs[i + whole];
+		const uint32_t high = i + whole + 1 < limbs.size() ? limbs[i + whole + 1] : 0;
+		limbs[i] = bits ? (low >> bits) | (high << (32 - bits)) : low;
+	}
+	limbs.resize(size);
+	removeLeadingZeros();
+	return *this;
+}
+
+BinaryInteger BinaryInteger::operator<<(size_t count) const {
+	BinaryInteger result(*this);
+	result <<= count;
+	return result;
+}
+
+BinaryInteger BinaryInteger::operator>>(size_t count) const {
+	BinaryInteger result(*this);
+	result >>= count;
+	return result;
+}
+
+BinaryInteger BinaryInteger::modPow(const BinaryInteger& exponent, const BinaryInteger& modulus) const {
+	if (modulus.isNegative || modulus.isZero()) {
+		throw std::invalid_argument("Modulus must be positive");
+	}
+	if (exponent.isNegative) {
+		throw std::invalid_argument("Exponent must be non-negative");
+	}
+	if (modulus == 1) {
+		return BinaryInteger();
+	}
+	BinaryInteger base = *this % modulus;
+	if (base.isNegative) {
+		base += modulus;
+	}
+	const std::span<const uint32_t> words(exponent.limbs.data(), exponent.limbs.size());
+
+	if ((modulus.limbs[0] & 1) == 0) {
+		return slidingWindowPow<BinaryInteger>(base, words, 1,
+			[&modulus](const BinaryInteger& x) { return x.square() % modulus; },
+			[&modulus](const BinaryInteger& x, const BinaryInteger& y) { return x * y % modulus; });
+	}
+
+	// 奇数模数：R = 2^(32n)，进出 Montgomery 形式各做一次取模，中间只做约简
+	const size_t n = modulus.limbs.size();
+	const uint32_t mInv = negativeInverse(modulus.limbs[0]);
+	auto reduce = [&](Limbs&& t) {
+		t.resize(2 * n + 1);
+		Limbs result(n);
+		montgomeryReduce(result.data(), t.data(), modulus.limbs.data(), n, mInv);
+		return BinaryInteger(std::move(result), false);
+	};
+	const BinaryInteger one = (BinaryInteger(1) << (32 * n)) % modulus;
+	const BinaryInteger result = slidingWindowPow<BinaryInteger>((base << (32 * n)) % modulus, words, one,
+		[&](const BinaryInteger& x) { return reduce(std::move(x.square().limbs)); },
+		[&](const BinaryInteger& x, const BinaryInteger& y) { return reduce(std::move((x * y).limbs)); });
+	return reduce(Limbs(result.limbs));
+}
+
+size_t BinaryInteger::bitLength() const {
+	return isZero() ? 0 : (limbs.size() - 1) * 32 + std::bit_width(limbs.back());
+}
+
+bool BinaryInteger::testBit(size_t index) const {
+	const size_t word = index / 32;
+	if (!isNegative) {
+		return word < limbs.size() && (limbs[word] >> (index % 32)) & 1;
+	}
+	// -x 的补码为 ~(x - 1)：最低非零块以下的块在 x - 1 中全为 1
+	size_t lowest = 0;
+	while (limbs[lowest] == 0) {
+		++lowest;
+	}
+	uint32_t value = 0xFFFFFFFFu;
+	if (word == lowest) {
+		value = limbs[word] - 1;
+	}
+	else if (word > lowest) {
+		value = word < limbs.size() ? limbs[word] : 0;
+	}
+	return !((value >> (index % 32)) & 1);
+}
+
+size_t BinaryInteger::popcount() const {
+	size_t count = 0;
+	for (uint32_t limb : limbs) {
+		count += std::popcount(limb);
+	}
+	return count;
+}
+
+std::string BinaryInteger::toString() const {
+	return toBigInteger().toString();
+}
+
+std::to_chars_result BinaryInteger::toChars(char* first, char* last) const {
+	return toBigInteger().toChars(first, last);
+}
+
+BinaryInteger BinaryInteger::fromChars(std::string_view str) {
+	return BinaryInteger(BigInteger::fromChars(str));
+}
+
+BIGINTEGER_DLL_API std::ostream& operator<<(std::ostream& os, const BinaryInteger& num) {
+	return os << num.toBigInteger();
+}
+
+BIGINTEGER_DLL_API std::istream& operator>>(std::istream& is, BinaryInteger& num) {
+	BigInteger value;
+	if (is >> value) {
+		num = BinaryInteger(value);
+	}
+	return is;
+}
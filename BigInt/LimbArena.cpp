@@ -0,0 +1,177 @@
+﻿#include "LimbArena.h"
+
+#include <algorithm>
+#include <bit>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace {
+
+constexpr int MIN_SHIFT = std::countr_zero(LimbArena::MIN_BYTES);
+constexpr size_t CLASS_COUNT = std::countr_zero(LimbArena::MAX_BYTES) - MIN_SHIFT + 1;
+
+// bytes 所属的大小级别，要求 bytes <= MAX_BYTES
+size_t sizeClass(size_t bytes) {
+	return bytes <= LimbArena::MIN_BYTES ? 0 : std::bit_width(bytes - 1) - MIN_SHIFT;
+}
+
+// 每级的空闲缓冲区用缓冲区自身的头部串成单链表
+struct FreeBlock {
+	FreeBlock* next;
+};
+
+struct Pool {
+	FreeBlock* heads[CLASS_COUNT] = {};
+	size_t counts[CLASS_COUNT] = {};
+	LimbArena::Stats stats;
+
+	~Pool();
+	void release() noexcept;
+};
+
+// 线程退出时 pool 先于其他对象析构，之后的释放直接交还全局堆。平凡类型的 thread_local 析构后仍可读取
+thread_local bool poolDestroyed = false;
+thread_local Pool pool;
+
+Pool::~Pool() {
+	release();
+	poolDestroyed = true;
+}
+
+void Pool::release() noexcept {
+	for (size_t c = 0; c < CLASS_COUNT; ++c) {
+		while (heads[c]) {
+			FreeBlock* block = heads[c];
+			heads[c] = block->next;
+			::operator delete(block);
+		}
+		counts[c] = 0;
+	}
+	stats.cachedBytes = 0;
+}
+
+size_t classLimit(size_t c) {
+	return std::max(LimbArena::MIN_CACHED, LimbArena::CACHED_BYTES_PER_CLASS >> (c + MIN_SHIFT));
+}
+
+struct Chunk {
+	std::byte* data;
+	size_t size;
+};
+
+void freeChunk(const Chunk& chunk) noexcept {
+	::operator delete(chunk.data, std::align_val_t(64));
+}
+
+// 分段依次使用：[0, current) 已用满，current 段已用 used 字节，之后的段空闲
+struct Scratch {
+	std::vector<Chunk> chunks;
+	size_t current = 0;
+	size_t used = 0;
+	int depth = 0;
+
+	~Scratch() {
+		for (const Chunk& chunk : chunks) {
+			freeChunk(chunk);
+		}
+	}
+};
+
+thread_local Scratch scratch;
+
+} // namespace
+
+void* LimbArena::allocate(size_t bytes) {
+	if (poolDestroyed) {
+		return ::operator new(bytes);
+	}
+	++pool.stats.allocations;
+	if (bytes > MAX_BYTES) {
+		++pool.stats.heapAllocations;
+		return ::operator new(bytes);
+	}
+	const size_t c = sizeClass(bytes);
+	if (FreeBlock* block = pool.heads[c]) {
+		pool.heads[c] = block->next;
+		--pool.counts[c];
+		pool.stats.cachedBytes -= MIN_BYTES << c;
+		return block;
+	}
+	++pool.stats.heapAllocations;
+	return ::operator new(MIN_BYTES << c);
+}
+
+void LimbArena::deallocate(void* p, size_t bytes) noexcept {
+	if (poolDestroyed || bytes > MAX_BYTES) {
+		::operator delete(p);
+		return;
+	}
+	const size_t c = sizeClass(bytes);
+	if (pool.counts[c] >= classLimit(c)) {
+		::operator delete(p);
+		return;
+	}
+	FreeBlock* block = static_cast<FreeBlock*>(p);
+	block->next = pool.heads[c];
+	pool.heads[c] = block;
+	++pool.counts[c];
+	pool.stats.cachedBytes += MIN_BYTES << c;
+}
+
+LimbArena::Stats LimbArena::stats() noexcept {
+	return poolDestroyed ? Stats() : pool.stats;
+}
+
+void LimbArena::trim() noexcept {
+	if (!poolDestroyed) {
+		pool.release();
+	}
+}
+
+ScratchArena::Scope::Scope() noexcept : _chunk(scratch.current), _used(scratch.used) {
+	++scratch.depth;
+}
+
+ScratchArena::Scope::~Scope() {
+	scratch.current = _chunk;
+	scratch.used = _used;
+	if (--scratch.depth == 0) {
+		// 较大的分段来自较大的乘除法，不再保留
+		std::erase_if(scratch.chunks, [](const Chunk& chunk) {
+			if (chunk.size > RETAINED_CHUNK_BYTES) {
+				freeChunk(chunk);
+				return true;
+			}
+			return false;
+		});
+	}
+}
+
+void* ScratchArena::allocateBytes(size_t bytes) {
+	bytes = (std::max<size_t>(bytes, 1) + 63) & ~size_t(63);
+	if (scratch.current < scratch.chunks.size()) {
+		Chunk& chunk = scratch.chunks[scratch.current];
+		if (chunk.size - scratch.used >= bytes) {
+			std::byte* p = chunk.data + scratch.used;
+			scratch.used += bytes;
+			return p;
+		}
+		++scratch.current;
+	}
+
+	// 换到下一段；空闲的段不够大时换成更大的一段
+	const size_t index = scratch.current;
+	if (index < scratch.chunks.size() && scratch.chunks[index].size < bytes) {
+		freeChunk(scratch.chunks[index]);
+		scratch.chunks.erase(scratch.chunks.begin() + index);
+	}
+	if (index >= scratch.chunks.size() || scratch.chunks[index].size < bytes) {
+		const size_t previous = index > 0 ? scratch.chunks[index - 1].size : INITIAL_CHUNK_BYTES / 2;
+		const size_t size = std::max(bytes, 2 * previous);
+		std::byte* data = static_cast<std::byte*>(::operator new(size, std::align_val_t(64)));
+		scratch.chunks.insert(scratch.chunks.begin() + index, Chunk{ data, size });
+	}
+	scratch.used = bytes;
+	return scratch.chunks[index].data;
+}
@@ -0,0 +1,484 @@
+﻿#include "LimbKernels.h"
+#include "LimbSimd.h"
+#include "LimbArena.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace limb {
+
+namespace {
+
+// 按 CPU 支持的指令集选择的逐块内核，首次使用时确定
+struct KernelTable {
+	uint32_t (*addN)(int32_t* r, const int32_t* a, const int32_t* b, size_t n, uint32_t carry);
+	uint32_t (*subN)(int32_t* r, const int32_t* a, const int32_t* b, size_t n, uint32_t borrow);
+	void (*mulAddRow)(uint64_t* acc, const int32_t* a, size_t n, uint32_t b);
+	uint64_t (*sumN)(const int32_t* a, size_t n);
+	void (*modN)(const int32_t* a, size_t n, const uint32_t* d, size_t count, uint32_t* r);
+};
+
+KernelTable selectKernels() {
+	switch (simd::detectLevel()) {
+#if LIMB_SIMD_X86
+	case simd::Level::Avx512:
+		return { avx512::addN, avx512::subN, avx512::mulAddRow, avx512::sumN, avx512::modN };
+	case simd::Level::Avx2:
+		return { avx2::addN, avx2::subN, avx2::mulAddRow, avx2::sumN, avx2::modN };
+#endif
+	default:
+		return { scalar::addN, scalar::subN, scalar::mulAddRow, scalar::sumN, scalar::modN };
+	}
+}
+
+const KernelTable& kernels() {
+	static const KernelTable table = selectKernels();
+	return table;
+}
+
+// 只剩进位（借位）时逐块传播，传播结束后 r 与 a 不是同一数组才需要复制剩余部分
+uint32_t propagateCarry(int32_t* r, const int32_t* a, size_t from, size_t n, uint32_t carry) {
+	size_t i = from;
+	for (; carry && i < n; ++i) {
+		uint32_t sum = static_cast<uint32_t>(a[i]) + carry;
+		carry = sum >= BASE;
+		r[i] = static_cast<int32_t>(carry ? sum - BASE : sum);
+	}
+	if (r != a) {
+		std::copy(a + i, a + n, r + i);
+	}
+
+	return carry;
+}
+
+uint32_t propagateBorrow(int32_t* r, const int32_t* a, size_t from, size_t n, uint32_t borrow) {
+	size_t i = from;
+	for (; borrow && i < n; ++i) {
+		int32_t diff = a[i] - static_cast<int32_t>(borrow);
+		borrow = diff < 0;
+		r[i] = borrow ? diff + static_cast<int32_t>(BASE) : diff;
+	}
+	if (r != a) {
+		std::copy(a + i, a + n, r + i);
+	}
+
+	return borrow;
+}
+
+} // namespace
+
+uint32_t add(int32_t* r, const int32_t* a, size_t na, const int32_t* b, size_t nb) {
+	uint32_t carry = kernels().addN(r, a, b, nb, 0);
+	return propagateCarry(r, a, nb, na, carry);
+}
+
+uint32_t sub(int32_t* r, const int32_t* a, size_t na, const int32_t* b, size_t nb) {
+	uint32_t borrow = kernels().subN(r, a, b, nb, 0);
+	return propagateBorrow(r, a, nb, na, borrow);
+}
+
+uint32_t addTo(int32_t* r, size_t nr, const int32_t* a, size_t na) {
+	// 进位传播到最后一个不产生进位的块即可停止
+	uint32_t carry = kernels().addN(r, r, a, na, 0);
+	return propagateCarry(r, r, na, nr, carry);
+}
+
+uint32_t subFrom(int32_t* r, size_t nr, const int32_t* a, size_t na) {
+	uint32_t borrow = kernels().subN(r, r, a, na, 0);
+	return propagateBorrow(r, r, na, nr, borrow);
+}
+
+uint32_t divSmall(int32_t* a, size_t n, uint32_t d) {
+	uint64_t rem = 0;
+	for (size_t i = n; i-- > 0; ) {
+		uint64_t cur = rem * BASE + static_cast<uint32_t>(a[i]);
+		a[i] = static_cast<int32_t>(cur / d);
+		rem = cur % d;
+	}
+
+	return static_cast<uint32_t>(rem);
+}
+
+uint32_t modSmall(const int32_t* a, size_t n, uint32_t d) {
+	// BASE ≡ 1 (mod d)（d 整除 999999999，如 3、9、37）时余数就是各块之和的余数
+	if ((BASE - 1) % d == 0) {
+		return static_cast<uint32_t>(kernels().sumN(a, n) % d);
+	}
+
+	// 否则每次并入 4 块再取模：rem = (rem * B^4 + Σ a[i+k] * B^k) mod d。
+	// d < 2^31 时每项小于 2^61，4 项与 rem * B^4 之和不超过 2^64
+	uint64_t rem = 0;
+	size_t i = n;
+	if (d < (1u << 31)) {
+		const uint64_t w1 = BASE % d;
+		const uint64_t w2 = w1 * w1 % d;
+		const uint64_t w3 = w2 * w1 % d;
+		const uint64_t w4 = w3 * w1 % d;
+		for (; i >= 4; i -= 4) {
+			const int32_t* block = a + i - 4;
+			rem = (rem * w4
+				+ static_cast<uint32_t>(block[3]) * w3
+				+ static_cast<uint32_t>(block[2]) * w2
+				+ static_cast<uint32_t>(block[1]) * w1
+				+ static_cast<uint32_t>(block[0])) % d;
+		}
+	}
+	for (; i-- > 0; ) {
+		rem = (rem * BASE + static_cast<uint32_t>(a[i])) % d;
+	}
+
+	return static_cast<uint32_t>(rem);
+}
+
+void modSmallMany(const int32_t* a, size_t n, const uint32_t* d, size_t count, uint32_t* r) {
+	kernels().modN(a, n, d, count, r);
+}
+
+void divmod(int32_t* q, int32_t* r, const int32_t* u, size_t nu, const int32_t* v, size_t nv) {
+	if (nv == 1) {
+		std::copy(u, u + nu, q);
+		r[0] = static_cast<int32_t>(divSmall(q, nu, static_cast<uint32_t>(v[0])));
+		return;
+	}
+
+	// 规范化：被除数和除数同乘 d，使除数最高块不小于 BASE / 2
+	const uint64_t d = BASE / (static_cast<uint64_t>(v[nv - 1]) + 1);
+	ScratchArena::Scope scope;
+	uint32_t* un = ScratchArena::allocate<uint32_t>(nu + 1 + nv);
+	uint32_t* vn = un + nu + 1;
+	uint64_t carry = 0;
+	for (size_t i = 0; i < nu; ++i) {
+		uint64_t cur = static_cast<uint32_t>(u[i]) * d + carry;
+		un[i] = static_cast<uint32_t>(cur % BASE);
+		carry = cur / BASE;
+	}
+	un[nu] = static_cast<uint32_t>(carry);
+	carry = 0;
+	for (size_t i = 0; i < nv; ++i) {
+		uint64_t cur = static_cast<uint32_t>(v[i]) * d + carry;
+		vn[i] = static_cast<uint32_t>(cur % BASE);
+		carry = cur / BASE;
+	}
+
+	const uint64_t vTop = vn[nv - 1];
+	const uint64_t vNext = vn[nv - 2];
+	for (size_t j = nu - nv + 1; j-- > 0; ) {
+		// 用最高两块估计商，再用次高块修正，估计值最多偏大 2
+		uint64_t num = un[j + nv] * static_cast<uint64_t>(BASE) + un[j + nv - 1];
+		uint64_t qhat = num / vTop;
+		uint64_t rhat = num % vTop;
+		while (qhat >= BASE || qhat * vNext > rhat * BASE + un[j + nv - 2]) {
+			--qhat;
+			rhat += vTop;
+			if (rhat >= BASE) {
+				break;
+			}
+		}
+
+		// un[j, j + nv] -= qhat * vn
+		uint64_t mulCarry = 0;
+		int64_t borrow = 0;
+		for (size_t i = 0; i < nv; ++i) {
+			uint64_t p = qhat * vn[i] + mulCarry;
+			mulCarry = p / BASE;
+			int64_t diff = static_cast<int64_t>(un[i + j]) - static_cast<int64_t>(p % BASE) - borrow;
+			borrow = diff < 0;
+			un[i + j] = static_cast<uint32_t>(borrow ? diff + BASE : diff);
+		}
+		int64_t top = static_cast<int64_t>(un[j + nv]) - static_cast<int64_t>(mulCarry) - borrow;
+
+		// 减成负数说明估计值多了 1，加回一次除数
+		if (top < 0) {
+			--qhat;
+			uint32_t addCarry = 0;
+			for (size_t i = 0; i < nv; ++i) {
+				uint32_t sum = un[i + j] + vn[i] + addCarry;
+				addCarry = sum >= BASE;
+				un[i + j] = addCarry ? sum - BASE : sum;
+			}
+			top += addCarry;
+		}
+		un[j + nv] = static_cast<uint32_t>(top);
+		q[j] = static_cast<int32_t>(qhat);
+	}
+
+	// 余数需要除回规范化因子
+	uint64_t rem = 0;
+	for (size_t i = nv; i-- > 0; ) {
+		uint64_t cur = rem * BASE + un[i];
+		r[i] = static_cast<int32_t>(cur / d);
+		rem = cur % d;
+	}
+}
+
+size_t normalizedSize(const int32_t* a, size_t n) {
+	while (n > 0 && a[n - 1] == 0) {
+		--n;
+	}
+
+	return n;
+}
+
+namespace {
+
+// 竖式乘法中乘积先不取模直接累加到 uint64_t：16 个小于 10^18 的乘积加上规整后的进位不会溢出
+constexpr size_t SCHOOLBOOK_ROWS = 16;
+// 竖式乘法每次处理的 a 的列数，累加缓冲放在栈上
+constexpr size_t SCHOOLBOOK_STRIP = 256;
+
+// r[0, n) += acc[0, count)，并把进位一直传播到 r 的末尾，要求 count <= n
+void foldAccumulator(int32_t* r, size_t n, const uint64_t* acc, size_t count) {
+	uint64_t carry = 0;
+	size_t i = 0;
+	for (; i < count; ++i) {
+		uint64_t cur = static_cast<uint32_t>(r[i]) + acc[i] + carry;
+		r[i] = static_cast<int32_t>(cur % BASE);
+		carry = cur / BASE;
+	}
+	for (; carry && i < n; ++i) {
+		uint64_t cur = static_cast<uint32_t>(r[i]) + carry;
+		r[i] = static_cast<int32_t>(cur % BASE);
+		carry = cur / BASE;
+	}
+}
+
+} // namespace
+
+void mulSchoolbook(int32_t* r, const int32_t* a, size_t na, const int32_t* b, size_t nb) {
+	std::fill(r, r + na + nb, 0);
+	const KernelTable& k = kernels();
+	uint64_t acc[SCHOOLBOOK_STRIP + SCHOOLBOOK_ROWS];
+	for (size_t column = 0; column < na; column += SCHOOLBOOK_STRIP) {
+		const size_t width = std::min(SCHOOLBOOK_STRIP, na - column);
+		for (size_t row = 0; row < nb; row += SCHOOLBOOK_ROWS) {
+			const size_t rows = std::min(SCHOOLBOOK_ROWS, nb - row);
+			std::fill(acc, acc + width + rows, 0);
+			for (size_t j = 0; j < rows; ++j) {
+				const uint32_t bj = static_cast<uint32_t>(b[row + j]);
+				if (bj != 0) {
+					k.mulAddRow(acc + j, a + column, width, bj);
+				}
+			}
+			foldAccumulator(r + column + row, na + nb - column - row, acc, width + rows);
+		}
+	}
+}
+
+void sqrSchoolbook(int32_t* r, const int32_t* a, size_t n) {
+	// 先累加 i < j 的交叉乘积，每 SCHOOLBOOK_ROWS 行规整一次
+	std::fill(r, r + 2 * n, 0);
+	const KernelTable& k = kernels();
+	uint64_t acc[2 * KARATSUBA_SQR_THRESHOLD];
+	for (size_t row = 0; row + 1 < n; row += SCHOOLBOOK_ROWS) {
+		const size_t last = std::min(row + SCHOOLBOOK_ROWS, n - 1);
+		// 这一组行写入 [from, from + count)
+		const size_t from = 2 * row + 1;
+		const size_t count = n + last - 1 - from;
+		std::fill(acc + from, acc + from + count, 0);
+		for (size_t i = row; i < last; ++i) {
+			const uint32_t ai = static_cast<uint32_t>(a[i]);
+			if (ai != 0) {
+				k.mulAddRow(acc + 2 * i + 1, a + i + 1, n - i - 1, ai);
+			}
+		}
+		foldAccumulator(r + from, 2 * n - from, acc + from, count);
+	}
+
+	// 交叉乘积翻倍，再加上对角线上的平方项
+	uint64_t carry = 0;
+	for (size_t i = 0; i < 2 * n; ++i) {
+		uint64_t cur = 2 * static_cast<uint64_t>(static_cast<uint32_t>(r[i])) + carry;
+		r[i] = static_cast<int32_t>(cur % BASE);
+		carry = cur / BASE;
+	}
+	carry = 0;
+	for (size_t i = 0; i < n; ++i) {
+		uint64_t ai = static_cast<uint32_t>(a[i]);
+		uint64_t square = ai * ai;
+		uint64_t low = static_cast<uint32_t>(r[2 * i]) + square % BASE + carry;
+		r[2 * i] = static_cast<int32_t>(low % BASE);
+		uint64_t high = static_cast<uint32_t>(r[2 * i + 1]) + square / BASE + low / BASE;
+		r[2 * i + 1] = static_cast<int32_t>(high % BASE);
+		carry = high / BASE;
+	}
+}
+
+void montgomeryReduce(int32_t* r, const int32_t* t, const int32_t* m, size_t n, uint32_t mInv) {
+	// 逐行加上 q * m * BASE^i 消去最低块，累加器每 SCHOOLBOOK_ROWS 行规整一次防止溢出
+	const KernelTable& k = kernels();
+	ScratchArena::Scope scope;
+	uint64_t* acc = ScratchArena::allocate<uint64_t>(2 * n + 1);
+	for (size_t i = 0; i < 2 * n; ++i) {
+		acc[i] = static_cast<uint32_t>(t[i]);
+	}
+	acc[2 * n] = 0;
+
+	for (size_t i = 0; i < n; ++i) {
+		const uint32_t q = static_cast<uint32_t>(acc[i] % BASE * mInv % BASE);
+		if (q != 0) {
+			k.mulAddRow(acc + i, m, n, q);
+		}
+		// acc[i] 已是 BASE 的倍数
+		acc[i + 1] += acc[i] / BASE;
+		if ((i + 1) % SCHOOLBOOK_ROWS == 0) {
+			uint64_t carry = 0;
+			for (size_t j = i + 1; j < 2 * n; ++j) {
+				const uint64_t cur = acc[j] + carry;
+				acc[j] = cur % BASE;
+				carry = cur / BASE;
+			}
+			acc[2 * n] += carry;
+		}
+	}
+
+	// 高半部分小于 2m，最多减一次
+	uint64_t carry = 0;
+	for (size_t j = n; j < 2 * n; ++j) {
+		const uint64_t cur = acc[j] + carry;
+		r[j - n] = static_cast<int32_t>(cur % BASE);
+		carry = cur / BASE;
+	}
+	bool geq = acc[2 * n] + carry != 0;
+	if (!geq) {
+		size_t j = n;
+		while (j > 0 && r[j - 1] == m[j - 1]) {
+			--j;
+		}
+		geq = j == 0 || r[j - 1] > m[j - 1];
+	}
+	if (geq) {
+		k.subN(r, r, m, n, 0);
+	}
+}
+
+void lehmerUpdate(int32_t* a, int32_t* b, size_t n, int64_t x0, int64_t y0, int64_t x1, int64_t y1) {
+	// 每块的线性组合小于 2 * 2^31 * BASE，加上进位仍在 int64_t 内；进位向下取整
+	int64_t carryA = 0;
+	int64_t carryB = 0;
+	for (size_t i = 0; i < n; ++i) {
+		const int64_t ai = a[i];
+		const int64_t bi = b[i];
+		const int64_t ta = x0 * ai + y0 * bi + carryA;
+		const int64_t tb = x1 * ai + y1 * bi + carryB;
+		carryA = ta / BASE;
+		carryB = tb / BASE;
+		int64_t ra = ta - carryA * BASE;
+		int64_t rb = tb - carryB * BASE;
+		if (ra < 0) {
+			ra += BASE;
+			--carryA;
+		}
+		if (rb < 0) {
+			rb += BASE;
+			--carryB;
+		}
+		a[i] = static_cast<int32_t>(ra);
+		b[i] = static_cast<int32_t>(rb);
+	}
+}
+
+namespace {
+
+// Karatsuba 平方：a^2 = z2 * B^2h + ((a0 + a1)^2 - z0 - z2) * B^h + z0
+void sqrKaratsuba(int32_t* r, const int32_t* a, size_t n) {
+	const size_t h = (n + 1) / 2;
+	const int32_t* a0 = a;
+	const int32_t* a1 = a + h;
+	const size_t na1 = n - h;
+
+	sqr(r, a0, h);
+	sqr(r + 2 * h, a1, na1);
+
+	ScratchArena::Scope scope;
+	int32_t* sa = ScratchArena::allocate<int32_t>(3 * h + 3);
+	int32_t* z1 = sa + h + 1;
+	sa[h] = static_cast<int32_t>(add(sa, a0, h, a1, na1));
+	size_t nsa = normalizedSize(sa, h + 1);
+	size_t nz1 = 2 * nsa;
+	sqr(z1, sa, nsa);
+	subFrom(z1, nz1, r, normalizedSize(r, 2 * h));
+	subFrom(z1, nz1, r + 2 * h, normalizedSize(r + 2 * h, 2 * na1));
+
+	addTo(r + h, 2 * n - h, z1, normalizedSize(z1, nz1));
+}
+
+// 不平衡乘法：把较长的 a 按 nb 分块，逐块与 b 相乘后累加，要求 na >= nb
+void mulUnbalanced(int32_t* r, const int32_t* a, size_t na, const int32_t* b, size_t nb) {
+	std::fill(r, r + na + nb, 0);
+	ScratchArena::Scope scope;
+	int32_t* tmp = ScratchArena::allocate<int32_t>(2 * nb);
+	for (size_t offset = 0; offset < na; offset += nb) {
+		size_t chunk = std::min(nb, na - offset);
+		mul(tmp, b, nb, a + offset, chunk);
+		addTo(r + offset, na + nb - offset, tmp, chunk + nb);
+	}
+}
+
+// Karatsuba 乘法，要求 na >= nb > (na + 1) / 2
+void mulKaratsuba(int32_t* r, const int32_t* a, size_t na, const int32_t* b, size_t nb) {
+	const size_t h = (na + 1) / 2;
+	const int32_t* a0 = a;
+	const int32_t* a1 = a + h;
+	const int32_t* b0 = b;
+	const int32_t* b1 = b + h;
+	const size_t na1 = na - h;
+	const size_t nb1 = nb - h;
+
+	// z0 = a0 * b0 写入低 2h 块，z2 = a1 * b1 写入高位
+	mul(r, a0, h, b0, h);
+	mul(r + 2 * h, a1, na1, b1, nb1);
+
+	// z1 = (a0 + a1) * (b0 + b1) - z0 - z2
+	ScratchArena::Scope scope;
+	int32_t* sa = ScratchArena::allocate<int32_t>(4 * h + 4);
+	int32_t* sb = sa + h + 1;
+	int32_t* z1 = sb + h + 1;
+	sa[h] = static_cast<int32_t>(add(sa, a0, h, a1, na1));
+	sb[h] = static_cast<int32_t>(add(sb, b0, h, b1, nb1));
+	size_t nsa = normalizedSize(sa, h + 1);
+	size_t nsb = normalizedSize(sb, h + 1);
+	size_t nz1 = nsa + nsb;
+	if (nsa >= nsb) {
+		mul(z1, sa, nsa, sb, nsb);
+	}
+	else {
+		mul(z1, sb, nsb, sa, nsa);
+	}
+	subFrom(z1, nz1, r, normalizedSize(r, 2 * h));
+	subFrom(z1, nz1, r + 2 * h, normalizedSize(r + 2 * h, na1 + nb1));
+
+	addTo(r + h, na + nb - h, z1, normalizedSize(z1, nz1));
+}
+
+} // namespace
+
+void mul(int32_t* r, const int32_t* a, size_t na, const int32_t* b, size_t nb) {
+	if (na < nb) {
+		std::swap(a, b);
+		std::swap(na, nb);
+	}
+
+	if (nb == 0) {
+		std::fill(r, r + na, 0);
+	}
+	else if (nb < KARATSUBA_THRESHOLD) {
+		mulSchoolbook(r, a, na, b, nb);
+	}
+	else if (nb <= (na + 1) / 2) {
+		mulUnbalanced(r, a, na, b, nb);
+	}
+	else {
+		mulKaratsuba(r, a, na, b, nb);
+	}
+}
+
+void sqr(int32_t* r, const int32_t* a, size_t n) {
+	if (n < KARATSUBA_SQR_THRESHOLD) {
+		sqrSchoolbook(r, a, n);
+	}
+	else {
+		sqrKaratsuba(r, a, n);
+	}
+}
+
+} // namespace limb
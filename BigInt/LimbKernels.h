@@ -0,0 +1,64 @@
+﻿#pragma once
+// 基于 10^9 进制的底层数位运算内核，只供 BigInt 库内部使用。
+// 所有函数都以“指针 + 长度”描述数位数组（低位在前），不负责分配内存，
+// 调用方保证输出缓冲区的长度足够。逐块加减和乘加在运行时按 CPU 选择 AVX2 / AVX-512 实现。
+
+#include <cstdint>
+#include <cstddef>
+
+namespace limb {
+
+constexpr uint32_t BASE = 10'0000'0000u;
+
+// Karatsuba 乘法的阈值：较短操作数的块数低于该值时使用竖式乘法
+constexpr size_t KARATSUBA_THRESHOLD = 32;
+// Karatsuba 平方的阈值，竖式平方只需一半的乘法，所以阈值更高
+constexpr size_t KARATSUBA_SQR_THRESHOLD = 48;
+// NTT 乘法的最大结果长度（受三个模数的 2 的幂次限制）
+constexpr size_t NTT_MAX_LENGTH = size_t(1) << 25;
+
+// r[0, na) = a[0, na) + b[0, nb)，要求 na >= nb，返回最高位进位
+uint32_t add(int32_t* r, const int32_t* a, size_t na, const int32_t* b, size_t nb);
+// r[0, na) = a[0, na) - b[0, nb)，要求 na >= nb，返回最高位借位
+uint32_t sub(int32_t* r, const int32_t* a, size_t na, const int32_t* b, size_t nb);
+// r[0, nr) += a[0, na)，要求 nr >= na，返回溢出 r 的进位
+uint32_t addTo(int32_t* r, size_t nr, const int32_t* a, size_t na);
+// r[0, nr) -= a[0, na)，要求 nr >= na，返回溢出 r 的借位
+uint32_t subFrom(int32_t* r, size_t nr, const int32_t* a, size_t na);
+// a[0, n) /= d（原地），返回余数，要求 d > 0（任意 32 位除数的商块都小于 BASE）
+uint32_t divSmall(int32_t* a, size_t n, uint32_t d);
+// a[0, n) % d，不产生商，要求 d > 0
+uint32_t modSmall(const int32_t* a, size_t n, uint32_t d);
+// r[j] = a[0, n) % d[j]，j ∈ [0, count)，一次遍历同时对多个除数取模，要求 d[j] > 0
+void modSmallMany(const int32_t* a, size_t n, const uint32_t* d, size_t count, uint32_t* r);
+
+// Knuth 算法 D：q[0, nu - nv + 1) = u / v，r[0, nv) = u % v
+// 要求 nu >= nv >= 1 且 v 的最高块不为 0，q、r 不能与 u、v 重叠
+void divmod(int32_t* q, int32_t* r, const int32_t* u, size_t nu, const int32_t* v, size_t nv);
+
+// 去掉高位的 0 之后的有效长度（至少为 0）
+size_t normalizedSize(const int32_t* a, size_t n);
+
+// r[0, na + nb) = a * b，r 不能与 a、b 重叠
+void mulSchoolbook(int32_t* r, const int32_t* a, size_t na, const int32_t* b, size_t nb);
+// r[0, na + nb) = a * b，按长度在竖式、Karatsuba 和不平衡分块之间选择
+void mul(int32_t* r, const int32_t* a, size_t na, const int32_t* b, size_t nb);
+// r[0, 2n) = a * a，利用对称性只计算一半的交叉乘积，r 不能与 a 重叠；要求 n < KARATSUBA_SQR_THRESHOLD，累加器放在栈上
+void sqrSchoolbook(int32_t* r, const int32_t* a, size_t n);
+// r[0, 2n) = a * a，按长度在竖式平方和 Karatsuba 平方之间选择
+void sqr(int32_t* r, const int32_t* a, size_t n);
+
+// Montgomery 约简：r[0, n) = t[0, 2n) * BASE^-n mod m，要求 t < m * BASE^n，m[n - 1] != 0 且 m 与 10 互素，
+// mInv = -m^-1 mod BASE；结果在 [0, m) 内，r 可以与 t 重叠
+void montgomeryReduce(int32_t* r, const int32_t* t, const int32_t* m, size_t n, uint32_t mInv);
+
+// Lehmer 余因子矩阵原地作用于两个数：(a, b) = (x0 a + y0 b, x1 a + y1 b)，|系数| < 2^31，
+// b 补齐到 n 块；要求两个结果都非负（余因子来自正确的商序列时成立）
+void lehmerUpdate(int32_t* a, int32_t* b, size_t n, int64_t x0, int64_t y0, int64_t x1, int64_t y1);
+
+// 三素数 NTT 乘法：r[0, na + nb) = a * b，要求 na + nb <= NTT_MAX_LENGTH
+void mulNtt(int32_t* r, const int32_t* a, size_t na, const int32_t* b, size_t nb);
+// 三素数 NTT 平方：r[0, 2na) = a * a，只做一次正变换，要求 2na <= NTT_MAX_LENGTH
+void sqrNtt(int32_t* r, const int32_t* a, size_t na);
+
+} // namespace limb
@@ -0,0 +1,409 @@
+﻿#include "LimbSimd.h"
+#include "LimbKernels.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#if LIMB_SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC 允许在任意函数中使用各指令集的内部函数；GCC 和 Clang 需要函数级的 target 属性
+#if defined(__GNUC__) || defined(__clang__)
+#define LIMB_TARGET_AVX2 __attribute__((target("avx2")))
+#define LIMB_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define LIMB_TARGET_AVX2
+#define LIMB_TARGET_AVX512
+#endif
+
+namespace limb {
+
+namespace simd {
+
+Level detectLevel() {
+	Level level = Level::Scalar;
+#if LIMB_SIMD_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] >= 7) {
+		__cpuid(info, 1);
+		// 还要确认操作系统保存 YMM / ZMM 寄存器（OSXSAVE 与 XCR0）
+		if ((info[2] & (1 << 27)) != 0) {
+			const unsigned long long xcr0 = _xgetbv(0);
+			__cpuidex(info, 7, 0);
+			if ((xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0) {
+				level = Level::Avx2;
+				if ((xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16)) != 0) {
+					level = Level::Avx512;
+				}
+			}
+		}
+	}
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		level = Level::Avx2;
+		if (__builtin_cpu_supports("avx512f")) {
+			level = Level::Avx512;
+		}
+	}
+#endif
+#endif
+
+	if (const char* forced = std::getenv("BIGINT_SIMD")) {
+		if (std::strcmp(forced, "scalar") == 0) {
+			level = Level::Scalar;
+		}
+		else if (std::strcmp(forced, "avx2") == 0 && level == Level::Avx512) {
+			level = Level::Avx2;
+		}
+	}
+
+	return level;
+}
+
+} // namespace simd
+
+namespace scalar {
+
+uint32_t addN(int32_t* r, const int32_t* a, const int32_t* b, size_t n, uint32_t carry) {
+	for (size_t i = 0; i < n; ++i) {
+		uint32_t sum = static_cast<uint32_t>(a[i]) + static_cast<uint32_t>(b[i]) + carry;
+		carry = sum >= BASE;
+		r[i] = static_cast<int32_t>(carry ? sum - BASE : sum);
+	}
+
+	return carry;
+}
+
+uint32_t subN(int32_t* r, const int32_t* a, const int32_t* b, size_t n, uint32_t borrow) {
+	int32_t carry = static_cast<int32_t>(borrow);
+	for (size_t i = 0; i < n; ++i) {
+		int32_t diff = a[i] - b[i] - carry;
+		carry = diff < 0;
+		r[i] = carry ? diff + static_cast<int32_t>(BASE) : diff;
+	}
+
+	return static_cast<uint32_t>(carry);
+}
+
+void mulAddRow(uint64_t* acc, const int32_t* a, size_t n, uint32_t b) {
+	for (size_t i = 0; i < n; ++i) {
+		acc[i] += static_cast<uint64_t>(static_cast<uint32_t>(a[i])) * b;
+	}
+}
+
+uint64_t sumN(const int32_t* a, size_t n) {
+	uint64_t sum = 0;
+	for (size_t i = 0; i < n; ++i) {
+		sum += static_cast<uint32_t>(a[i]);
+	}
+
+	return sum;
+}
+
+void modN(const int32_t* a, size_t n, const uint32_t* d, size_t count, uint32_t* r) {
+	// x = rem * BASE + a[i] < 2^62。商的浮点估计误差远小于 1，截断后最多差 1，
+	// 所以 x - q * p 落在 (-p, 2p) 内，各修正一次即可。每次同时推进 4 个除数
+	constexpr size_t WAYS = 4;
+	for (size_t j = 0; j < count; j += WAYS) {
+		const size_t ways = count - j < WAYS ? count - j : WAYS;
+		int64_t p[WAYS];
+		double inverse[WAYS];
+		int64_t rem[WAYS] = {};
+		for (size_t k = 0; k < WAYS; ++k) {
+			// 不足 4 个时用 1 补齐，结果丢弃
+			p[k] = k < ways ? d[j + k] : 1;
+			inverse[k] = 1.0 / static_cast<double>(p[k]);
+		}
+		for (size_t i = n; i-- > 0; ) {
+			for (size_t k = 0; k < WAYS; ++k) {
+				const int64_t x = rem[k] * BASE + a[i];
+				const int64_t q = static_cast<int64_t>(static_cast<double>(x) * inverse[k]);
+				int64_t t = x - q * p[k];
+				t += t < 0 ? p[k] : 0;
+				t -= t >= p[k] ? p[k] : 0;
+				rem[k] = t;
+			}
+		}
+		for (size_t k = 0; k < ways; ++k) {
+			r[j + k] = static_cast<uint32_t>(rem[k]);
+		}
+	}
+}
+
+} // namespace scalar
+
+#if LIMB_SIMD_X86
+
+// 逐块加减的进位用位掩码一次解决：g 为本块自身产生进位（借位）的通道，
+// p 为只有收到进位才会继续传出的通道（和为 BASE - 1，或差为 0）。
+// 把它们当作二进制数，((g << 1) | cin) + p 的加法进位链恰好就是进位在通道间的传播，
+// 再与 p 异或得到每个通道收到的进位，溢出的最高位就是传给下一组的进位。
+
+// modN 同时推进的寄存器组数
+constexpr size_t MOD_GROUPS = 4;
+
+namespace avx2 {
+
+LIMB_TARGET_AVX2
+uint32_t addN(int32_t* r, const int32_t* a, const int32_t* b, size_t n, uint32_t carry) {
+	const __m256i top = _mm256_set1_epi32(static_cast<int32_t>(BASE - 1));
+	const __m256i base = _mm256_set1_epi32(static_cast<int32_t>(BASE));
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256i sum = _mm256_add_epi32(
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+		const uint32_t g = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(sum, top))));
+		const uint32_t p = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(sum, top))));
+		const uint32_t x = ((g << 1) | carry) + p;
+		const uint32_t incoming = (x ^ p) & 0xFF;
+		carry = x >> 8;
+
+		sum = _mm256_add_epi32(sum, _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int32_t>(incoming)), lanes), one));
+		sum = _mm256_sub_epi32(sum, _mm256_and_si256(_mm256_cmpgt_epi32(sum, top), base));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(r + i), sum);
+	}
+
+	return scalar::addN(r + i, a + i, b + i, n - i, carry);
+}
+
+LIMB_TARGET_AVX2
+uint32_t subN(int32_t* r, const int32_t* a, const int32_t* b, size_t n, uint32_t borrow) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i base = _mm256_set1_epi32(static_cast<int32_t>(BASE));
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256i diff = _mm256_sub_epi32(
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+		const uint32_t g = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(zero, diff))));
+		const uint32_t p = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(diff, zero))));
+		const uint32_t x = ((g << 1) | borrow) + p;
+		const uint32_t incoming = (x ^ p) & 0xFF;
+		borrow = x >> 8;
+
+		diff = _mm256_sub_epi32(diff, _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int32_t>(incoming)), lanes), one));
+		diff = _mm256_add_epi32(diff, _mm256_and_si256(_mm256_cmpgt_epi32(zero, diff), base));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(r + i), diff);
+	}
+
+	return scalar::subN(r + i, a + i, b + i, n - i, borrow);
+}
+
+LIMB_TARGET_AVX2
+void mulAddRow(uint64_t* acc, const int32_t* a, size_t n, uint32_t b) {
+	const __m256i factor = _mm256_set1_epi64x(b);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256i low = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+		const __m256i high = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 4)));
+		__m256i* out = reinterpret_cast<__m256i*>(acc + i);
+		_mm256_storeu_si256(out, _mm256_add_epi64(_mm256_loadu_si256(out), _mm256_mul_epu32(low, factor)));
+		_mm256_storeu_si256(out + 1, _mm256_add_epi64(_mm256_loadu_si256(out + 1), _mm256_mul_epu32(high, factor)));
+	}
+
+	scalar::mulAddRow(acc + i, a + i, n - i, b);
+}
+
+LIMB_TARGET_AVX2
+uint64_t sumN(const int32_t* a, size_t n) {
+	__m256i total = _mm256_setzero_si256();
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+		total = _mm256_add_epi64(total, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(v)));
+		total = _mm256_add_epi64(total, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(v, 1)));
+	}
+
+	alignas(32) uint64_t lanes[4];
+	_mm256_store_si256(reinterpret_cast<__m256i*>(lanes), total);
+	return lanes[0] + lanes[1] + lanes[2] + lanes[3] + scalar::sumN(a + i, n - i);
+}
+
+LIMB_TARGET_AVX2
+void modN(const int32_t* a, size_t n, const uint32_t* d, size_t count, uint32_t* r) {
+	// 各通道为 64 位：rem < 2^32 通过与 2^52 的位模式拼接精确转换为浮点数
+	const __m256i magic = _mm256_set1_epi64x(0x4330000000000000LL);
+	const __m256d magicValue = _mm256_set1_pd(4503599627370496.0);
+	const __m256i base = _mm256_set1_epi64x(BASE);
+	const __m256d baseValue = _mm256_set1_pd(static_cast<double>(BASE));
+	const __m256i zero = _mm256_setzero_si256();
+	size_t j = 0;
+	for (; j + 4 * MOD_GROUPS <= count; j += 4 * MOD_GROUPS) {
+		__m256i p[MOD_GROUPS];
+		__m256d inverse[MOD_GROUPS];
+		__m256i rem[MOD_GROUPS];
+		for (size_t g = 0; g < MOD_GROUPS; ++g) {
+			p[g] = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(d + j + 4 * g)));
+			const __m256d value = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(p[g], magic)), magicValue);
+			inverse[g] = _mm256_div_pd(_mm256_set1_pd(1.0), value);
+			rem[g] = zero;
+		}
+		for (size_t i = n; i-- > 0; ) {
+			const __m256i limb = _mm256_set1_epi64x(a[i]);
+			const __m256d limbValue = _mm256_set1_pd(static_cast<double>(a[i]));
+			for (size_t g = 0; g < MOD_GROUPS; ++g) {
+				const __m256d remValue = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(rem[g], magic)), magicValue);
+				const __m256d x = _mm256_add_pd(_mm256_mul_pd(remValue, baseValue), limbValue);
+				const __m256i q = _mm256_cvtepi32_epi64(_mm256_cvttpd_epi32(_mm256_mul_pd(x, inverse[g])));
+				__m256i t = _mm256_sub_epi64(
+					_mm256_add_epi64(_mm256_mul_epu32(rem[g], base), limb),
+					_mm256_mul_epu32(q, p[g]));
+				t = _mm256_add_epi64(t, _mm256_and_si256(_mm256_cmpgt_epi64(zero, t), p[g]));
+				t = _mm256_sub_epi64(t, _mm256_andnot_si256(_mm256_cmpgt_epi64(p[g], t), p[g]));
+				rem[g] = t;
+			}
+		}
+		for (size_t g = 0; g < MOD_GROUPS; ++g) {
+			alignas(32) uint64_t lanes[4];
+			_mm256_store_si256(reinterpret_cast<__m256i*>(lanes), rem[g]);
+			for (size_t k = 0; k < 4; ++k) {
+				r[j + 4 * g + k] = static_cast<uint32_t>(lanes[k]);
+			}
+		}
+	}
+
+	scalar::modN(a, n, d + j, count - j, r + j);
+}
+
+} // namespace avx2
+
+namespace avx512 {
+
+// 乘法和扩展都用全掩码的 maskz 形式：无掩码形式在 GCC 12 中会误报未初始化警告
+
+LIMB_TARGET_AVX512
+uint32_t addN(int32_t* r, const int32_t* a, const int32_t* b, size_t n, uint32_t carry) {
+	const __m512i top = _mm512_set1_epi32(static_cast<int32_t>(BASE - 1));
+	const __m512i base = _mm512_set1_epi32(static_cast<int32_t>(BASE));
+	const __m512i one = _mm512_set1_epi32(1);
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m512i sum = _mm512_add_epi32(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+		const uint32_t g = _mm512_cmpgt_epi32_mask(sum, top);
+		const uint32_t p = _mm512_cmpeq_epi32_mask(sum, top);
+		const uint32_t x = ((g << 1) | carry) + p;
+		const __mmask16 incoming = static_cast<__mmask16>(x ^ p);
+		carry = x >> 16;
+
+		sum = _mm512_mask_add_epi32(sum, incoming, sum, one);
+		sum = _mm512_mask_sub_epi32(sum, _mm512_cmpgt_epi32_mask(sum, top), sum, base);
+		_mm512_storeu_si512(r + i, sum);
+	}
+
+	return avx2::addN(r + i, a + i, b + i, n - i, carry);
+}
+
+LIMB_TARGET_AVX512
+uint32_t subN(int32_t* r, const int32_t* a, const int32_t* b, size_t n, uint32_t borrow) {
+	const __m512i zero = _mm512_setzero_si512();
+	const __m512i base = _mm512_set1_epi32(static_cast<int32_t>(BASE));
+	const __m512i one = _mm512_set1_epi32(1);
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m512i diff = _mm512_sub_epi32(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+		const uint32_t g = _mm512_cmplt_epi32_mask(diff, zero);
+		const uint32_t p = _mm512_cmpeq_epi32_mask(diff, zero);
+		const uint32_t x = ((g << 1) | borrow) + p;
+		const __mmask16 incoming = static_cast<__mmask16>(x ^ p);
+		borrow = x >> 16;
+
+		diff = _mm512_mask_sub_epi32(diff, incoming, diff, one);
+		diff = _mm512_mask_add_epi32(diff, _mm512_cmplt_epi32_mask(diff, zero), diff, base);
+		_mm512_storeu_si512(r + i, diff);
+	}
+
+	return avx2::subN(r + i, a + i, b + i, n - i, borrow);
+}
+
+LIMB_TARGET_AVX512
+void mulAddRow(uint64_t* acc, const int32_t* a, size_t n, uint32_t b) {
+	const __m512i factor = _mm512_set1_epi64(b);
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		const __m512i low = _mm512_maskz_cvtepu32_epi64(0xFF, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)));
+		const __m512i high = _mm512_maskz_cvtepu32_epi64(0xFF, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i + 8)));
+		_mm512_storeu_si512(acc + i, _mm512_add_epi64(_mm512_loadu_si512(acc + i), _mm512_maskz_mul_epu32(0xFF, low, factor)));
+		_mm512_storeu_si512(acc + i + 8, _mm512_add_epi64(_mm512_loadu_si512(acc + i + 8), _mm512_maskz_mul_epu32(0xFF, high, factor)));
+	}
+
+	avx2::mulAddRow(acc + i, a + i, n - i, b);
+}
+
+LIMB_TARGET_AVX512
+uint64_t sumN(const int32_t* a, size_t n) {
+	__m512i total = _mm512_setzero_si512();
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+		const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i + 8));
+		total = _mm512_add_epi64(total, _mm512_maskz_cvtepu32_epi64(0xFF, low));
+		total = _mm512_add_epi64(total, _mm512_maskz_cvtepu32_epi64(0xFF, high));
+	}
+
+	alignas(64) uint64_t lanes[8];
+	_mm512_store_si512(lanes, total);
+	uint64_t sum = 0;
+	for (uint64_t lane : lanes) {
+		sum += lane;
+	}
+	return sum + avx2::sumN(a + i, n - i);
+}
+
+LIMB_TARGET_AVX512
+void modN(const int32_t* a, size_t n, const uint32_t* d, size_t count, uint32_t* r) {
+	const __m512i magic = _mm512_set1_epi64(0x4330000000000000LL);
+	const __m512d magicValue = _mm512_set1_pd(4503599627370496.0);
+	const __m512i base = _mm512_set1_epi64(BASE);
+	const __m512d baseValue = _mm512_set1_pd(static_cast<double>(BASE));
+	const __m512i zero = _mm512_setzero_si512();
+	size_t j = 0;
+	for (; j + 8 * MOD_GROUPS <= count; j += 8 * MOD_GROUPS) {
+		__m512i p[MOD_GROUPS];
+		__m512d inverse[MOD_GROUPS];
+		__m512i rem[MOD_GROUPS];
+		for (size_t g = 0; g < MOD_GROUPS; ++g) {
+			p[g] = _mm512_maskz_cvtepu32_epi64(0xFF, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(d + j + 8 * g)));
+			const __m512d value = _mm512_sub_pd(_mm512_castsi512_pd(_mm512_or_si512(p[g], magic)), magicValue);
+			inverse[g] = _mm512_div_pd(_mm512_set1_pd(1.0), value);
+			rem[g] = zero;
+		}
+		for (size_t i = n; i-- > 0; ) {
+			const __m512i limb = _mm512_set1_epi64(a[i]);
+			const __m512d limbValue = _mm512_set1_pd(static_cast<double>(a[i]));
+			for (size_t g = 0; g < MOD_GROUPS; ++g) {
+				const __m512d remValue = _mm512_sub_pd(_mm512_castsi512_pd(_mm512_or_si512(rem[g], magic)), magicValue);
+				const __m512d x = _mm512_add_pd(_mm512_mul_pd(remValue, baseValue), limbValue);
+				const __m512i q = _mm512_maskz_cvtepi32_epi64(0xFF, _mm512_maskz_cvttpd_epi32(0xFF, _mm512_mul_pd(x, inverse[g])));
+				__m512i t = _mm512_sub_epi64(
+					_mm512_add_epi64(_mm512_maskz_mul_epu32(0xFF, rem[g], base), limb),
+					_mm512_maskz_mul_epu32(0xFF, q, p[g]));
+				t = _mm512_mask_add_epi64(t, _mm512_cmplt_epi64_mask(t, zero), t, p[g]);
+				t = _mm512_mask_sub_epi64(t, _mm512_cmpge_epi64_mask(t, p[g]), t, p[g]);
+				rem[g] = t;
+			}
+		}
+		for (size_t g = 0; g < MOD_GROUPS; ++g) {
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(r + j + 8 * g), _mm512_maskz_cvtepi64_epi32(0xFF, rem[g]));
+		}
+	}
+
+	avx2::modN(a, n, d + j, count - j, r + j);
+}
+
+} // namespace avx512
+
+#endif
+
+} // namespace limb
@@ -0,0 +1,59 @@
+﻿#pragma once
+// 10^9 进制逐块内核的各指令集版本和运行时 CPU 特性检测，只供 LimbKernels.cpp 使用。
+// AVX2 / AVX-512 版本用函数级的 target 属性编译，同一个库可以在所有 x86-64 机器上运行，
+// 由 LimbKernels.cpp 在首次调用时按 detectLevel() 选择。
+
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define LIMB_SIMD_X86 1
+#else
+#define LIMB_SIMD_X86 0
+#endif
+
+namespace limb {
+
+namespace simd {
+
+enum class Level { Scalar, Avx2, Avx512 };
+
+// 当前 CPU 和操作系统支持的最高指令集，环境变量 BIGINT_SIMD=scalar 或 avx2 可以强制降级
+Level detectLevel();
+
+} // namespace simd
+
+// 每个指令集提供同样的一组内核：
+// addN: r[0, n) = a + b + carry，返回进位；subN: r[0, n) = a - b - borrow，返回借位，
+//       r 可以与 a 或 b 是同一数组
+// mulAddRow: acc[0, n) += a[0, n) * b，不取模也不传播进位，由调用方保证 acc 不溢出
+// sumN: a[0, n) 各块之和
+// modN: r[j] = a[0, n) % d[j]，j ∈ [0, count)，要求 d[j] > 0。每个除数的余数用预先算好的
+//       浮点倒数估计商，不做整数除法；多个除数同时推进以隐藏逐块 Horner 的依赖延迟
+namespace scalar {
+uint32_t addN(int32_t* r, const int32_t* a, const int32_t* b, size_t n, uint32_t carry);
+uint32_t subN(int32_t* r, const int32_t* a, const int32_t* b, size_t n, uint32_t borrow);
+void mulAddRow(uint64_t* acc, const int32_t* a, size_t n, uint32_t b);
+uint64_t sumN(const int32_t* a, size_t n);
+void modN(const int32_t* a, size_t n, const uint32_t* d, size_t count, uint32_t* r);
+} // namespace scalar
+
+#if LIMB_SIMD_X86
+namespace avx2 {
+uint32_t addN(int32_t* r, const int32_t* a, const int32_t* b, size_t n, uint32_t carry);
+uint32_t subN(int32_t* r, const int32_t* a, const int32_t* b, size_t n, uint32_t borrow);
+void mulAddRow(uint64_t* acc, const int32_t* a, size_t n, uint32_t b);
+uint64_t sumN(const int32_t* a, size_t n);
+void modN(const int32_t* a, size_t n, const uint32_t* d, size_t count, uint32_t* r);
+} // namespace avx2
+
+namespace avx512 {
+uint32_t addN(int32_t* r, const int32_t* a, const int32_t* b, size_t n, uint32_t carry);
+uint32_t subN(int32_t* r, const int32_t* a, const int32_t* b, size_t n, uint32_t borrow);
+void mulAddRow(uint64_t* acc, const int32_t* a, size_t n, uint32_t b);
+uint64_t sumN(const int32_t* a, size_t n);
+void modN(const int32_t* a, size_t n, const uint32_t* d, size_t count, uint32_t* r);
+} // namespace avx512
+#endif
+
+} // namespace limb
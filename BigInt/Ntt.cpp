@@ -0,0 +1,243 @@
+﻿#include "LimbKernels.h"
+
+#include <algorithm>
+#include <vector>
+
+// 三素数数论变换（NTT）乘法。
+// 直接以 10^9 进制的块作为卷积系数，三个模数之积约为 1.6 * 10^26，
+// 大于 2^24 * (10^9)^2，所以在最大变换长度 2^25 以内卷积结果可以被精确还原。
+
+namespace limb {
+
+namespace {
+
+// 32 位 Montgomery 模乘，要求模数为小于 2^31 的奇数
+class Montgomery32 {
+public:
+	explicit Montgomery32(uint32_t mod) : mod(mod) {
+		// 牛顿迭代求 mod^-1 mod 2^32
+		uint32_t inv = mod;
+		for (int i = 0; i < 4; ++i) {
+			inv *= 2 - mod * inv;
+		}
+		negInv = 0u - inv;
+		uint64_t r = (1ull << 32) % mod;
+		r2 = static_cast<uint32_t>(r * r % mod);
+	}
+
+	uint32_t reduce(uint64_t x) const {
+		uint32_t m = static_cast<uint32_t>(x) * negInv;
+		uint32_t t = static_cast<uint32_t>((x + static_cast<uint64_t>(m) * mod) >> 32);
+		return t >= mod ? t - mod : t;
+	}
+
+	uint32_t mul(uint32_t a, uint32_t b) const {
+		return reduce(static_cast<uint64_t>(a) * b);
+	}
+
+	uint32_t add(uint32_t a, uint32_t b) const {
+		uint32_t s = a + b;
+		return s >= mod ? s - mod : s;
+	}
+
+	uint32_t sub(uint32_t a, uint32_t b) const {
+		return a >= b ? a - b : a + mod - b;
+	}
+
+	// 普通形式转换到 Montgomery 形式
+	uint32_t toMont(uint32_t a) const {
+		return mul(a % mod, r2);
+	}
+
+	uint32_t pow(uint32_t base, uint64_t e) const {
+		uint32_t result = toMont(1);
+		uint32_t b = toMont(base);
+		while (e > 0) {
+			if (e & 1) {
+				result = mul(result, b);
+			}
+			b = mul(b, b);
+			e >>= 1;
+		}
+
+		return result;
+	}
+
+	const uint32_t mod;
+
+private:
+	uint32_t negInv;
+	uint32_t r2;
+};
+
+struct NttPrime {
+	uint32_t mod;
+	uint32_t root;
+};
+
+constexpr NttPrime PRIMES[3] = {
+	{ 2013265921u, 31 },	// 15 * 2^27 + 1
+	{ 469762049u, 3 },		// 7 * 2^26 + 1
+	{ 167772161u, 3 },		// 5 * 2^25 + 1
+};
+
+// 变换所需的单位根表：roots[len + j] = w_{2len}^j（Montgomery 形式）
+std::vector<uint32_t> makeRoots(const Montgomery32& m, uint32_t g, size_t n, bool inverse) {
+	std::vector<uint32_t> roots(std::max<size_t>(n, 2));
+	for (size_t len = 1; len < n; len <<= 1) {
+		uint64_t e = (m.mod - 1) / (2 * len);
+		if (inverse) {
+			e = (m.mod - 1) - e;
+		}
+		uint32_t w = m.pow(g, e);
+		uint32_t cur = m.toMont(1);
+		for (size_t j = 0; j < len; ++j) {
+			roots[len + j] = cur;
+			cur = m.mul(cur, w);
+		}
+	}
+
+	return roots;
+}
+
+// 频率抽取正变换：自然顺序输入，位逆序输出
+void forward(std::vector<uint32_t>& a, const Montgomery32& m, const std::vector<uint32_t>& roots) {
+	const size_t n = a.size();
+	for (size_t len = n >> 1; len >= 1; len >>= 1) {
+		for (size_t i = 0; i < n; i += 2 * len) {
+			uint32_t* x = a.data() + i;
+			uint32_t* y = x + len;
+			const uint32_t* w = roots.data() + len;
+			for (size_t j = 0; j < len; ++j) {
+				uint32_t u = x[j];
+				uint32_t v = y[j];
+				x[j] = m.add(u, v);
+				y[j] = m.mul(m.sub(u, v), w[j]);
+			}
+		}
+	}
+}
+
+// 时间抽取逆变换：位逆序输入，自然顺序输出（未除以 n）
+void inverse(std::vector<uint32_t>& a, const Montgomery32& m, const std::vector<uint32_t>& roots) {
+	const size_t n = a.size();
+	for (size_t len = 1; len < n; len <<= 1) {
+		for (size_t i = 0; i < n; i += 2 * len) {
+			uint32_t* x = a.data() + i;
+			uint32_t* y = x + len;
+			const uint32_t* w = roots.data() + len;
+			for (size_t j = 0; j < len; ++j) {
+				uint32_t u = x[j];
+				uint32_t v = m.mul(y[j], w[j]);
+				x[j] = m.add(u, v);
+				y[j] = m.sub(u, v);
+			}
+		}
+	}
+}
+
+void load(std::vector<uint32_t>& dst, const int32_t* a, size_t na, uint32_t mod) {
+	std::fill(dst.begin(), dst.end(), 0);
+	for (size_t i = 0; i < na; ++i) {
+		dst[i] = static_cast<uint32_t>(a[i]) % mod;
+	}
+}
+
+// 在一个模数下计算 a * b（b 为空时计算 a 的平方），结果为普通形式
+std::vector<uint32_t> convolve(const NttPrime& prime, size_t n,
+	const int32_t* a, size_t na, const int32_t* b, size_t nb) {
+	Montgomery32 m(prime.mod);
+	std::vector<uint32_t> roots = makeRoots(m, prime.root, n, false);
+
+	std::vector<uint32_t> fa(n);
+	load(fa, a, na, prime.mod);
+	forward(fa, m, roots);
+
+	if (b) {
+		std::vector<uint32_t> fb(n);
+		load(fb, b, nb, prime.mod);
+		forward(fb, m, roots);
+		for (size_t i = 0; i < n; ++i) {
+			fa[i] = m.mul(fa[i], fb[i]);
+		}
+	}
+	else {
+		for (size_t i = 0; i < n; ++i) {
+			fa[i] = m.mul(fa[i], fa[i]);
+		}
+	}
+
+	roots = makeRoots(m, prime.root, n, true);
+	inverse(fa, m, roots);
+
+	// 逐点乘积带有因子 R^-1，逆变换还需除以 n：整体乘以 n^-1 * R^2 再做一次约简
+	uint32_t scale = m.pow(static_cast<uint32_t>(n % prime.mod), prime.mod - 2);
+	scale = m.mul(scale, m.toMont(m.toMont(1)));
+	for (size_t i = 0; i < n; ++i) {
+		fa[i] = m.mul(fa[i], scale);
+	}
+
+	return fa;
+}
+
+uint64_t powMod(uint64_t base, uint64_t e, uint64_t mod) {
+	uint64_t result = 1;
+	base %= mod;
+	while (e > 0) {
+		if (e & 1) {
+			result = result * base % mod;
+		}
+		base = base * base % mod;
+		e >>= 1;
+	}
+
+	return result;
+}
+
+void multiply(int32_t* r, const int32_t* a, size_t na, const int32_t* b, size_t nb) {
+	const size_t size = na + (b ? nb : na);
+	size_t n = 1;
+	while (n < size) {
+		n <<= 1;
+	}
+
+	std::vector<uint32_t> c1 = convolve(PRIMES[0], n, a, na, b, nb);
+	std::vector<uint32_t> c2 = convolve(PRIMES[1], n, a, na, b, nb);
+	std::vector<uint32_t> c3 = convolve(PRIMES[2], n, a, na, b, nb);
+
+	// Garner 中国剩余定理：x = a1 + m1 * k2 + m1 * m2 * k3
+	const uint64_t m1 = PRIMES[0].mod;
+	const uint64_t m2 = PRIMES[1].mod;
+	const uint64_t m3 = PRIMES[2].mod;
+	const uint64_t m1InvMod2 = powMod(m1 % m2, m2 - 2, m2);
+	const uint64_t m12InvMod3 = powMod(m1 % m3 * (m2 % m3) % m3, m3 - 2, m3);
+	const uint64_t m12 = m1 * m2;
+	const uint64_t m12High = m12 / BASE;
+	const uint64_t m12Low = m12 % BASE;
+
+	uint64_t carry = 0;
+	for (size_t i = 0; i < size; ++i) {
+		uint64_t x1 = c1[i];
+		uint64_t k2 = (c2[i] + m2 - x1 % m2) % m2 * m1InvMod2 % m2;
+		uint64_t t = x1 + m1 * k2;	// < m1 * m2 < 2^61
+		uint64_t k3 = (c3[i] + m3 - t % m3) % m3 * m12InvMod3 % m3;
+
+		// 值 = t + k3 * m12 = s + k3 * m12High * BASE，逐块进位
+		uint64_t s = t + k3 * m12Low;
+		uint64_t cur = s % BASE + carry;
+		r[i] = static_cast<int32_t>(cur % BASE);
+		carry = cur / BASE + s / BASE + k3 * m12High;
+	}
+}
+
+} // namespace
+
+void mulNtt(int32_t* r, const int32_t* a, size_t na, const int32_t* b, size_t nb) {
+	multiply(r, a, na, b, nb);
+}
+
+void sqrNtt(int32_t* r, const int32_t* a, size_t na) {
+	multiply(r, a, na, nullptr, 0);
+}
+
+} // namespace limb
@@ -0,0 +1,163 @@
+﻿#include "PrimeTable.h"
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+
+namespace {
+
+// 余数到位号的映射，与 30 不互素的余数为 -1
+constexpr auto BIT_OF_RESIDUE = [] {
+	std::array<int8_t, 30> bits{};
+	bits.fill(-1);
+	for (int k = 0; k < 8; ++k) {
+		bits[PrimeTable::RESIDUES[k]] = static_cast<int8_t>(k);
+	}
+	return bits;
+}();
+
+// 余数不超过 r 的位组成的掩码
+constexpr auto MASK_UP_TO = [] {
+	std::array<uint8_t, 30> masks{};
+	for (uint32_t r = 0; r < 30; ++r) {
+		for (int k = 0; k < 8; ++k) {
+			if (PrimeTable::RESIDUES[k] <= r) {
+				masks[r] |= static_cast<uint8_t>(1u << k);
+			}
+		}
+	}
+	return masks;
+}();
+
+} // namespace
+
+bool PrimeTable::load(const FileNameType& fileName, const MapOptions& options) {
+	// 先映射并校验新文件，成功后才替换当前的表；失败时已加载的表保持不变
+	MemoryMapFile mapped;
+	if (!mapped.open(fileName, options)) {
+		return false;
+	}
+
+	const size_t fileSize = mapped.size();
+	const auto* bytes = static_cast<const uint8_t*>(mapped.data());
+	Header header;
+	if (fileSize >= sizeof(Header)) {
+		std::memcpy(&header, bytes, sizeof(Header));
+	}
+	if (fileSize < sizeof(Header) || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+		// 旧格式：跳过可能存在的 2、3、5
+		const std::span<const uint32_t> primes = mapped.view<uint32_t>();
+		const uint32_t* first = std::upper_bound(primes.data(), primes.data() + primes.size(), 5u);
+		if (first == primes.data() + primes.size()) {
+			return false;
+		}
+		file = std::move(mapped);
+		legacy = first;
+		bitmap = nullptr;
+		blockIndex = nullptr;
+		blockCount = 0;
+		count = primes.data() + primes.size() - first;
+		last = primes.back();
+		return true;
+	}
+
+	const size_t blocks = header.bitmapBytes / BLOCK_BYTES;
+	const bool valid = header.version == VERSION && header.blockBytes == BLOCK_BYTES
+		&& header.bitmapBytes % BLOCK_BYTES == 0 && header.count != 0
+		&& fileSize == sizeof(Header) + header.bitmapBytes + blocks * sizeof(uint32_t)
+		&& updateChecksum(0, bytes + sizeof(Header), fileSize - sizeof(Header)) == header.checksum;
+	if (!valid) {
+		std::cerr << "Prime table version or checksum mismatch." << std::endl;
+		return false;
+	}
+
+	// 移动映射不改变映射的地址，bytes 仍然有效
+	file = std::move(mapped);
+	legacy = nullptr;
+	bitmap = bytes + sizeof(Header);
+	blockIndex = reinterpret_cast<const uint32_t*>(bitmap + header.bitmapBytes);
+	blockCount = blocks;
+	count = header.count;
+	last = (*this)[count - 1];
+	return true;
+}
+
+uint32_t PrimeTable::operator[](size_t index) const {
+	return *iteratorAt(index);
+}
+
+bool PrimeTable::contains(uint32_t value) const {
+	if (legacy) {
+		return std::binary_search(legacy, legacy + count, value);
+	}
+	const int bit = BIT_OF_RESIDUE[value % 30];
+	return value <= last && bit >= 0 && (bitmap[value / 30] >> bit & 1) != 0;
+}
+
+size_t PrimeTable::upperBound(uint32_t value) const {
+	if (legacy) {
+		return std::upper_bound(legacy, legacy + count, value) - legacy;
+	}
+	if (value >= last) {
+		return count;
+	}
+
+	// 所在块之前的个数，加上块内此前各字节和当前字节中不超过 value 的位
+	const size_t byte = value / 30;
+	const size_t block = byte / BLOCK_BYTES;
+	size_t rank = blockIndex[block];
+	for (size_t i = block * BLOCK_BYTES; i < byte; ++i) {
+		rank += std::popcount(bitmap[i]);
+	}
+	return rank + std::popcount(static_cast<uint8_t>(bitmap[byte] & MASK_UP_TO[value % 30]));
+}
+
+size_t PrimeTable::decode(size_t index, size_t n, uint32_t* out) const {
+	n = index < count ? std::min(n, count - index) : 0;
+	if (legacy) {
+		std::copy(legacy + index, legacy + index + n, out);
+		return n;
+	}
+
+	Iterator it = iteratorAt(index);
+	for (size_t i = 0; i < n; ++i, ++it) {
+		out[i] = *it;
+	}
+	return n;
+}
+
+PrimeTable::Iterator PrimeTable::end() const {
+	Iterator it;
+	it.table = this;
+	it.index = count;
+	return it;
+}
+
+PrimeTable::Iterator PrimeTable::iteratorAt(size_t index) const {
+	if (index >= count) {
+		return end();
+	}
+
+	Iterator it;
+	it.table = this;
+	it.index = index;
+	if (legacy) {
+		return it;
+	}
+
+	// 在索引中找到所在的块，再在块内逐字节数出第 index 个置位
+	const size_t block = std::upper_bound(blockIndex, blockIndex + blockCount, static_cast<uint32_t>(index)) - blockIndex - 1;
+	size_t remaining = index - blockIndex[block];
+	size_t byte = block * BLOCK_BYTES;
+	while (static_cast<size_t>(std::popcount(bitmap[byte])) <= remaining) {
+		remaining -= std::popcount(bitmap[byte]);
+		++byte;
+	}
+	uint8_t bits = bitmap[byte];
+	for (; remaining > 0; --remaining) {
+		bits &= bits - 1;
+	}
+	it.byte = byte;
+	it.bits = bits;
+	return it;
+}
@@ -0,0 +1,69 @@
+﻿#pragma once
+// BigInteger 与 BinaryInteger 共用的滑动窗口幂，只供 BigInt 库内部使用
+
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// 滑动窗口的宽度，指数越长窗口越宽（预计算 2^(w-1) 个奇数次幂）
+inline int slidingWindowWidth(size_t bits) {
+	return bits > 671 ? 6 : bits > 239 ? 5 : bits > 79 ? 4 : bits > 23 ? 3 : bits > 7 ? 2 : 1;
+}
+
+// 从高位到低位的滑动窗口幂，words 为指数的二进制表示（低位在前的 32 位字，最高字不为 0）。
+// 每个窗口以 1 结尾，只需一次乘法，乘数从预计算的奇数次幂中取
+template <typename Integer, typename Square, typename Multiply>
+Integer slidingWindowPow(const Integer& base, std::span<const uint32_t> words, const Integer& one,
+	Square square, Multiply multiply) {
+	if (words.empty()) {
+		return one;
+	}
+	const size_t bits = (words.size() - 1) * 32 + std::bit_width(words.back());
+	auto bit = [&words](size_t i) { return (words[i / 32] >> (i % 32)) & 1; };
+	const size_t width = slidingWindowWidth(bits);
+
+	// odd[i] = base^(2i + 1)
+	std::vector<Integer> odd(size_t(1) << (width - 1));
+	odd[0] = base;
+	if (odd.size() > 1) {
+		const Integer base2 = square(base);
+		for (size_t i = 1; i < odd.size(); ++i) {
+			odd[i] = multiply(odd[i - 1], base2);
+		}
+	}
+
+	// 最高位为 1，第一个窗口直接取表
+	Integer result;
+	bool started = false;
+	size_t i = bits;
+	while (i > 0) {
+		if (!bit(i - 1)) {
+			result = square(result);
+			--i;
+			continue;
+		}
+		// 窗口 [low, i)，长度不超过 width 且最低位为 1
+		size_t low = i > width ? i - width : 0;
+		while (!bit(low)) {
+			++low;
+		}
+		size_t value = 0;
+		for (size_t j = i; j-- > low;) {
+			value = value * 2 + bit(j);
+		}
+		if (started) {
+			for (size_t j = low; j < i; ++j) {
+				result = square(result);
+			}
+			result = multiply(result, odd[value / 2]);
+		}
+		else {
+			result = odd[value / 2];
+			started = true;
+		}
+		i = low;
+	}
+	return result;
+}
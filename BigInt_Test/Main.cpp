@@ -1,6 +1,9 @@
 ﻿#include <chrono>
+#include <sstream>
+#include <tuple>
 
 #include "BigInteger.h"
+#include "BinaryInteger.h"
 #include "MemoryMapFile.h"
 
 void testIsPrime(const BigInteger& num, bool ret, const BigInteger& div) {
@@ -23,7 +26,8 @@ void testIsPrimes() {
 	testIsPrime("3"_bi, true, "0"_bi);
 	testIsPrime("5"_bi, true, "0"_bi);
 	testIsPrime("4"_bi, false, "2"_bi);
-	testIsPrime("15"_bi, false, "5"_bi);
+	testIsPrime("15"_bi, false, "3"_bi);
+	testIsPrime("25"_bi, false, "5"_bi);
 	testIsPrime("9"_bi, false, "3"_bi);
 	testIsPrime("123456789"_bi, false, "3"_bi);
 	testIsPrime("12'121212121'212121212'111111111'123456789"_bi, false, "3"_bi);
@@ -32,8 +36,382 @@ void testIsPrimes() {
 	testIsPrime("+49"_bi, false, "7"_bi);
 }
 
+void testFromChars(const char* str, const std::string& expected) {
+	std::string result;
+	try {
+		result = BigInteger::fromChars(str).toString();
+	}
+	catch (const std::invalid_argument&) {
+		result = "invalid";
+	}
+
+	if (result == expected) {
+		std::cout << "正确: BigInteger::fromChars(\"" << str << "\") 验证成功。" << std::endl;
+	}
+	else {
+		std::cout << "错误: BigInteger::fromChars(\"" << str << "\") 验证失败：" << std::endl;
+		std::cout << "\t期望: " << expected << std::endl;
+		std::cout << "\t得到: " << result << std::endl;
+	}
+}
+
+void testStringConversions() {
+	testFromChars("0", "0");
+	testFromChars("-0", "0");
+	testFromChars("+42", "42");
+	testFromChars("-98'7654'3210", "-9876543210");
+	testFromChars("000000000000000000001", "1");
+	testFromChars("1'000000000'000000000", "1000000000000000000");
+	testFromChars("'1", "invalid");
+	testFromChars("1'", "invalid");
+	testFromChars("1''2", "invalid");
+	testFromChars("-'1", "invalid");
+	testFromChars("1-2", "invalid");
+	testFromChars("12a", "invalid");
+
+	std::istringstream in(" -12'345'678'901'234'567'890 +7");
+	BigInteger a;
+	BigInteger b;
+	in >> a >> b;
+	std::ostringstream out;
+	out << a << ',' << b;
+	if (in && out.str() == "-12345678901234567890,7") {
+		std::cout << "正确: operator>> 验证成功。" << std::endl;
+	}
+	else {
+		std::cout << "错误: operator>> 验证失败：" << out.str() << std::endl;
+	}
+}
+
+void testNativeValue(const char* name, const BigInteger& value, const std::string& expected) {
+	if (value.toString() == expected) {
+		std::cout << "正确: " << name << " = " << expected << std::endl;
+	}
+	else {
+		std::cout << "错误: " << name << " 应为 " << expected << "，实际为 " << value << std::endl;
+	}
+}
+
+void testNativeOperands() {
+	BigInteger a = "-1'000000000'000000000"_bi;
+	testNativeValue("a + 1", a + 1, "-999999999999999999");
+	testNativeValue("a - UINT64_MAX", a - std::numeric_limits<uint64_t>::max(), "-19446744073709551615");
+	testNativeValue("a * INT64_MIN", a * std::numeric_limits<int64_t>::min(), "9223372036854775808000000000000000000");
+	testNativeValue("a / 7u", a / 7u, "-142857142857142857");
+	testNativeValue("a % 7u", a % 7u, "-1");
+	testNativeValue("5 - a", 5 - a, "1000000000000000005");
+
+	auto [quotient, remainder] = a.divmod(3);
+	if (quotient.toString() == "-333333333333333333" && remainder == -1 && a.mod(3) == 1
+		&& a < -1 && a != 0 && std::numeric_limits<int64_t>::min() < a) {
+		std::cout << "正确: divmod、mod 与原生整数比较验证成功。" << std::endl;
+	}
+	else {
+		std::cout << "错误: divmod、mod 与原生整数比较验证失败。" << std::endl;
+	}
+}
+
+void testFibonacci() {
+	// L(n) = F(n-1) + F(n+1)
+	const int64_t n = 12345;
+	auto [f, next] = BigInteger::fibonacciPair(n);
+	if (f == BigInteger::fibonacci(n) && BigInteger::lucas(n) == BigInteger::fibonacci(n - 1) + next
+		&& BigInteger::fibonacci(90) == 2880067194370816120ull) {
+		std::cout << "正确: fibonacci、fibonacciPair 与 lucas 验证成功。" << std::endl;
+	}
+	else {
+		std::cout << "错误: fibonacci、fibonacciPair 与 lucas 验证失败。" << std::endl;
+	}
+}
+
+void testProducts() {
+	// 30# = 2 * 3 * 5 * 7 * 11 * 13 * 17 * 19 * 23 * 29
+	if (BigInteger::factorial(25) == "15511210043330985984000000"_bi
+		&& BigInteger::rangeProduct(501, 2000) * BigInteger::factorial(500) == BigInteger::factorial(2000)
+		&& BigInteger::rangeProduct(-5, -1) == -120
+		&& BigInteger::primorial(30) == 6469693230ull) {
+		std::cout << "正确: factorial、rangeProduct 与 primorial 验证成功。" << std::endl;
+	}
+	else {
+		std::cout << "错误: factorial、rangeProduct 与 primorial 验证失败。" << std::endl;
+	}
+}
+
+void testMultiplyPaths() {
+	// F(2n) = F(n) * L(n)：F(1500) 约 35 块走 Karatsuba，F(10000) 约 233 块走 Toom-3
+	const bool karatsuba = BigInteger::fibonacci(1500) * BigInteger::lucas(1500) == BigInteger::fibonacci(3000);
+	const bool toom3 = BigInteger::fibonacci(10000) * BigInteger::lucas(10000) == BigInteger::fibonacci(20000);
+	// 40 块、233 块分别乘约 2090 块：前者在内核中分块，后者在 innerMul 中分块；
+	// 与平方展开 2ab = (a + b)^2 - a^2 - b^2 中的平衡乘法对照
+	const BigInteger large = BigInteger::fibonacci(90000);
+	bool unbalanced = true;
+	for (const BigInteger& small : { BigInteger::fibonacci(1700), BigInteger::fibonacci(10000) }) {
+		unbalanced = unbalanced && 2 * (small * large) == (small + large).square() - small.square() - large.square();
+	}
+	// Knuth 算法 D：除数约 24 块，被除数约 83 块，不到 Burnikel-Ziegler 的阈值
+	const BigInteger a = BigInteger::fibonacci(2500);
+	const BigInteger b = BigInteger::fibonacci(1000);
+	const BigInteger r = BigInteger::fibonacci(999);
+	const BigInteger n = a * b + r;
+	const bool knuth = n / b == a && n % b == r && (n - r - 1) / b == a - 1 && (n - r - 1) % b == b - 1
+		&& (-n) / b == -a && (-n) % b == -r;
+	if (karatsuba && toom3 && unbalanced && knuth) {
+		std::cout << "正确: Karatsuba、Toom-3、不平衡乘法与 Knuth 除法验证成功。" << std::endl;
+	}
+	else {
+		std::cout << "错误: Karatsuba、Toom-3、不平衡乘法与 Knuth 除法验证失败。" << std::endl;
+	}
+}
+
+void testNttMultiply() {
+	// F(200000) 与 L(200000) 约 4645 块，乘法超过 NTT 阈值 2000 块，平方超过 1600 块。
+	// F(2n) = F(n) * L(n) 检查乘法，L(n)^2 - 5 F(n)^2 = 4（n 为偶数）检查平方
+	const BigInteger f = BigInteger::fibonacci(200000);
+	const BigInteger l = BigInteger::lucas(200000);
+	if (f * l == BigInteger::fibonacci(400000) && l.square() - 5 * f.square() == 4 && f.square() == f * BigInteger(f)) {
+		std::cout << "正确: NTT 乘法与平方验证成功。" << std::endl;
+	}
+	else {
+		std::cout << "错误: NTT 乘法与平方验证失败。" << std::endl;
+	}
+}
+
+void testBurnikelZiegler() {
+	// 除数约 186 块和 189 块，超过 Burnikel-Ziegler 的阈值 160 块；被除数长出 117 块以上，F(20000) 的情形要分成多段逐段递归。
+	// 余数取 b - 1 时 3n/2n 步骤的商估计偏大，需要加回除数修正；全 9 的数使高位商达到上限 BASE^half - 1
+	const BigInteger f = BigInteger::fibonacci(8000);
+	const BigInteger nines = BigInteger::fromChars(std::string(1700, '9'));
+	const std::tuple<BigInteger, BigInteger, BigInteger> cases[] = {
+		{ BigInteger::fibonacci(5000), f, BigInteger::fibonacci(7999) },
+		{ BigInteger::fibonacci(20000), f, f - 1 },
+		{ BigInteger::fromChars(std::string(1100, '9')), nines, nines - 1 },
+	};
+	bool ok = true;
+	for (const auto& [a, b, r] : cases) {
+		const BigInteger n = a * b + r;
+		ok = ok && n / b == a && n % b == r && (n - r - 1) / b == a - 1 && (n - r - 1) % b == b - 1
+			&& (-n) / b == -a && (-n) % b == -r;
+	}
+	if (ok) {
+		std::cout << "正确: Burnikel-Ziegler 除法验证成功。" << std::endl;
+	}
+	else {
+		std::cout << "错误: Burnikel-Ziegler 除法验证失败。" << std::endl;
+	}
+}
+
+void testProbablePrimes() {
+	// 2047 = 23 * 89 是以 2 为底的强伪素数，5459 = 53 * 103 是强卢卡斯伪素数
+	BigInteger::PrimalityOptions options;
+	options.mode = BigInteger::PrimalityMode::Probabilistic;
+	options.trialBound = 10;
+	BigInteger divisor;
+	const BigInteger mersenne521 = BigInteger::fromChars("6864797660130609714981900799081393217269435300143305409394463459185543183397656052122559640661454554977296311391480858037121987999716643812574028291115057151");
+	if (mersenne521.isProbablePrime(4)
+		&& !(mersenne521 * 1000000007u).isProbablePrime()
+		&& !"2047"_bi.isPrimeNumber(divisor, options) && divisor == 0
+		&& !"5459"_bi.isPrimeNumber(divisor, options) && divisor == 0
+		&& !"7000021"_bi.isPrimeNumber(divisor, options) && divisor == 7) {
+		std::cout << "正确: isProbablePrime 与 Baillie-PSW 验证成功。" << std::endl;
+	}
+	else {
+		std::cout << "错误: isProbablePrime 与 Baillie-PSW 验证失败。" << std::endl;
+	}
+}
+
+void testParallelTrialDivision() {
+	// 两个因子都在素数表之外时由 mod 30 轮试除，多线程时应与单线程得到同样的最小因子
+	const BigInteger n = "170141183460469231731687303715884105727"_bi * 3000017u * 3000029u;
+	BigInteger::PrimalityOptions options;
+	options.threads = 4;
+	BigInteger divisor;
+	if (!n.isPrimeNumber(divisor, options) && divisor == 3000017u) {
+		std::cout << "正确: 多线程试除验证成功。" << std::endl;
+	}
+	else {
+		std::cout << "错误: 多线程试除验证失败：" << divisor << std::endl;
+	}
+}
+
+void testMemoryMapFile() {
+	// 可写的共享映射写入后重新只读映射；移动后原对象不再持有映射
+	const uint32_t values[] = { 7, 11, 13, 17 };
+	MapOptions options;
+	options.writable = true;
+	options.shared = true;
+	options.size = sizeof(values);
+	bool ok = false;
+	{
+		MemoryMapFile output;
+		if (output.open(USTR("mmfile_test.dat"), options)) {
+			std::copy(std::begin(values), std::end(values), output.mutableView<uint32_t>().begin());
+			ok = output.flush();
+		}
+	}
+	MemoryMapFile input;
+	ok = ok && input.open(USTR("mmfile_test.dat"), { .populate = true, .advice = MapAdvice::Sequential });
+	MemoryMapFile moved = std::move(input);
+	const std::span<const uint32_t> view = moved.view<uint32_t>();
+	if (ok && !input.isOpen() && view.size() == 4 && std::equal(view.begin(), view.end(), std::begin(values))) {
+		std::cout << "正确: MemoryMapFile 验证成功。" << std::endl;
+	}
+	else {
+		std::cout << "错误: MemoryMapFile 验证失败。" << std::endl;
+	}
+	moved.unLoad();
+	std::filesystem::remove("mmfile_test.dat");
+}
+
+void testPrimeTable() {
+	// 压缩素数表的随机访问、计数与遍历应当一致；新旧两种格式的 primes.dat 都可以
+	PrimeTable table;
+	if (!table.load(USTR("primes.dat"))) {
+		std::cout << "跳过: 没有 primes.dat，未验证 PrimeTable。" << std::endl;
+		return;
+	}
+
+	const size_t middle = table.size() / 2;
+	uint32_t decoded[3] = {};
+	table.decode(middle, 3, decoded);
+	const std::vector<uint32_t> first(table.begin(), std::next(table.begin(), 5));
+	if (table[0] == 7 && table.upperBound(100) == 22 && table.contains(97) && !table.contains(91)
+		&& first == std::vector<uint32_t>{ 7, 11, 13, 17, 19 }
+		&& decoded[0] == table[middle] && decoded[2] == table[middle + 2]
+		&& table.upperBound(table[middle]) == middle + 1 && table.upperBound(table.back()) == table.size()) {
+		std::cout << "正确: PrimeTable 验证成功。" << std::endl;
+	}
+	else {
+		std::cout << "错误: PrimeTable 验证失败。" << std::endl;
+	}
+}
+
+void testModPow() {
+	// 费马小定理：p 为素数时 a^(p-1) ≡ 1 (mod p)；模数为偶数时不能用 Montgomery 乘法
+	const BigInteger p = BigInteger::fromChars("170141183460469231731687303715884105727");
+	const MontgomeryContext context(p);
+	if ("123456789"_bi.modPow(p - 1, p) == 1
+		&& (-"2"_bi).modPow(10, 1000) == 24
+		&& "3"_bi.modPow(200, "1000000000000"_bi) == "384699044001"_bi
+		&& "7"_bi.modPow(0, 13) == 1
+		&& context.fromMontgomery(context.multiply(context.toMontgomery(6), context.toMontgomery(7))) == 42) {
+		std::cout << "正确: modPow 与 MontgomeryContext 验证成功。" << std::endl;
+	}
+	else {
+		std::cout << "错误: modPow 与 MontgomeryContext 验证失败。" << std::endl;
+	}
+}
+
+void testRoots() {
+	// 长数走高位递归的初值，(r + 1)^2 - 1 是平方根恰好不进位的边界；次数不小于位数时根为 1，接近位数时根为 2
+	const BigInteger r = BigInteger::fibonacci(1000);
+	const BigInteger n = (r + 1).square() - 1;
+	if (n.isqrt() == r && (n + 1).isqrt() == r + 1 && (n + 1).isPerfectSquare() && !n.isPerfectSquare()
+		&& (r * r * r).iroot(3) == r && (-(r * r * r) + 1).iroot(3) == -(r - 1)
+		&& "1000000000000000000000"_bi.iroot(7) == 1000 && "999999999999999999999"_bi.iroot(7) == 999 && "99"_bi.isqrt() == 9
+		&& "1000000000000000000000000000000"_bi.iroot(4000000000u) == 1 && (-"1000000000000000000000000000000"_bi).iroot(4000000001u) == -1
+		&& "1000000000000000000000000000000"_bi.iroot(99) == 2 && (n * n).iroot(2000) == 2) {
+		std::cout << "正确: isqrt、iroot 与 isPerfectSquare 验证成功。" << std::endl;
+	}
+	else {
+		std::cout << "错误: isqrt、iroot 与 isPerfectSquare 验证失败。" << std::endl;
+	}
+}
+
+void testGcd() {
+	// 相邻的斐波那契数是欧几里得算法的最坏情况；F(20000) 约 460 块，会用到半 GCD
+	const BigInteger a = BigInteger::fibonacci(20000);
+	const BigInteger b = BigInteger::fibonacci(19999);
+	const BigInteger g = "123456789012345678901234567890"_bi;
+	const auto [d, x, y] = BigInteger::extendedGcd(a * g, -b * g);
+	if (BigInteger::gcd(a * g, b * g) == g && d == g && a * g * x - b * g * y == g
+		&& BigInteger::gcd(0, 0) == 0 && BigInteger::lcm(-"4"_bi, 6) == 12
+		&& "3"_bi.modInverse(7) == 5 && (-"3"_bi).modInverse(7) == 2 && a.modInverse(b) * a % b == 1) {
+		std::cout << "正确: gcd、extendedGcd 与 modInverse 验证成功。" << std::endl;
+	}
+	else {
+		std::cout << "错误: gcd、extendedGcd 与 modInverse 验证失败。" << std::endl;
+	}
+}
+
+void testBinaryInteger() {
+	// F(3000) 约 66 块，进制转换会走分治；负数的按位运算和右移与补码一致
+	const BigInteger f = BigInteger::fibonacci(3000);
+	const BinaryInteger x(f);
+	const BinaryInteger y = -(BinaryInteger(1) << 100) + 12345;
+	if (x.toBigInteger() == f && BinaryInteger::fromChars(f.toString()) == x && (x * y) / y == x
+		&& (x << 77) >> 77 == x && (y >> 3) == -(BinaryInteger(1) << 97) + 1543
+		&& (BinaryInteger(-6) & 11) == 10 && (BinaryInteger(-6) | 3) == -5 && (BinaryInteger(-6) ^ -1) == 5 && ~BinaryInteger(5) == -6
+		&& BinaryInteger(-8).testBit(3) && !BinaryInteger(-8).testBit(2) && BinaryInteger(-8).testBit(1000)
+		&& BinaryInteger(255).popcount() == 8 && (BinaryInteger(1) << 100).bitLength() == 101 && BinaryInteger().bitLength() == 0
+		&& BinaryInteger(4).modPow(13, 497) == 445 && BinaryInteger(3).modPow(200, 1000) == 1 && y.toString() == "-1267650600228229401496703193031") {
+		std::cout << "正确: BinaryInteger 验证成功。" << std::endl;
+	}
+	else {
+		std::cout << "错误: BinaryInteger 验证失败。" << std::endl;
+	}
+}
+
+void testLimbArena() {
+	// 第一轮的结果释放后进入当前线程的缓存，第二轮同样大小的计算不再经过全局堆
+	const BigInteger first = BigInteger::fibonacci(5000) * BigInteger::fibonacci(4999);
+	const LimbArena::Stats before = LimbArena::stats();
+	const BigInteger second = BigInteger::fibonacci(5000) * BigInteger::fibonacci(4999);
+	const LimbArena::Stats after = LimbArena::stats();
+
+	bool scratchOk;
+	{
+		ScratchArena::Scope outer;
+		int32_t* a = ScratchArena::allocate<int32_t>(1000);
+		int32_t* b;
+		{
+			ScratchArena::Scope inner;
+			b = ScratchArena::allocate<int32_t>(1 << 20);
+		}
+		// 内层作用域归还后，同样的请求得到同一块空间
+		ScratchArena::Scope again;
+		scratchOk = a != b && ScratchArena::allocate<int32_t>(1 << 20) == b;
+	}
+	if (first == second && after.allocations > before.allocations && after.heapAllocations == before.heapAllocations && scratchOk) {
+		std::cout << "正确: LimbArena 与 ScratchArena 验证成功。" << std::endl;
+	}
+	else {
+		std::cout << "错误: LimbArena 与 ScratchArena 验证失败。" << std::endl;
+	}
+}
+
+void testFactor() {
+	// 两个 15 位素因子需要 Pollard-Brent rho，平方因子由平方根检查拆分
+	const std::vector<BigInteger> expected = { 2, 2, 3, 97, 119363859194689ull, 400090279927531ull };
+	const BigInteger n = "47756319838433517010940082859"_bi * 1164;
+	const std::vector<BigInteger> square = ("999999999989"_bi * 999999999989ull).factor();
+	if (n.factor() == expected && (-n).factor() == expected && "1"_bi.factor().empty()
+		&& square.size() == 2 && square[0] == 999999999989ull && square[1] == 999999999989ull) {
+		std::cout << "正确: factor 验证成功。" << std::endl;
+	}
+	else {
+		std::cout << "错误: factor 验证失败。" << std::endl;
+	}
+}
+
 int main() {
 	testIsPrimes();
+	testProbablePrimes();
+	testParallelTrialDivision();
+	testMemoryMapFile();
+	testPrimeTable();
+	testModPow();
+	testRoots();
+	testGcd();
+	testFactor();
+	testBinaryInteger();
+	testLimbArena();
+	testStringConversions();
+	testNativeOperands();
+	testFibonacci();
+	testProducts();
+	testMultiplyPaths();
+	testNttMultiply();
+	testBurnikelZiegler();
 	std::cout << "42"_bi << std::endl;
 //	std::cout << 0x11111abc2_bi << std::endl;
 //	std::cout << "42"_bi << std::endl;
@@ -1,62 +1,175 @@
 ﻿#include <iostream>
-#include <deque>
+#include <vector>
+#include <thread>
+#include <string>
 #include <limits>
-#include <fstream>
-#include <memory>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <bit>
+#include <atomic>
 
-static bool isPrime(uint32_t value, const uint32_t* primes, size_t size) noexcept
+#include "PrimeTable.h"
+
+// 分段筛法生成 primes.dat，格式见 PrimeTable.h：从 7 开始的素数的 mod 30 位图及其分块索引（2、3、5 由调用方单独处理）。
+// 每个字节表示 30 个连续整数中与 30 互素的 8 个，分段大小与 L2 缓存相当；
+// 输出文件按最终大小建立共享映射，各线程依次领取分段直接筛进映射，最后顺序计算索引和校验和。
+// 用法：print_primes [上界，默认 4294967295] [输出文件，默认 primes.dat] [线程数，默认全部硬件线程]
+
+// 与 30 互素的余数，以及余数到位号的映射
+static const uint32_t* const RESIDUES = PrimeTable::RESIDUES;
+static int8_t bitOfResidue[30];
+
+// 每段的字节数，覆盖 30 * SEGMENT_BYTES 个整数，须为 PrimeTable::BLOCK_BYTES 的倍数
+static const uint64_t SEGMENT_BYTES = 64 * 1024;
+
+// 筛法用到的素数 p（不含 2、3、5），以及对 8 个与 30 互素的乘数余数 m，p * m 所在的位号
+struct SievingPrime
 {
-	for (size_t i = 0; i < size; ++i)
+	uint32_t prime;
+	int8_t bits[8];
+};
+
+static std::vector<SievingPrime> smallPrimes(uint32_t limit)
+{
+	std::vector<bool> composite(limit + 1, false);
+	std::vector<SievingPrime> primes;
+	for (uint32_t i = 2; i <= limit; ++i)
 	{
-		const uint32_t x = primes[i];
-		if (value % x == 0)
-			return false;
-		if (value / x < x)
+		if (composite[i])
+			continue;
+		for (uint64_t j = static_cast<uint64_t>(i) * i; j <= limit; j += i)
+			composite[j] = true;
+		if (i <= 5)
+			continue;
+
+		SievingPrime sp;
+		sp.prime = i;
+		for (int k = 0; k < 8; ++k)
+			sp.bits[k] = bitOfResidue[static_cast<uint64_t>(i) * RESIDUES[k] % 30];
+		primes.push_back(sp);
+	}
+	return primes;
+}
+
+// 筛 [low, low + 30 * bytes)，low 是 30 的倍数，sieve 中留下不小于 7 且不超过 bound 的素数对应的位
+static void sieveSegment(uint64_t low, uint64_t bytes, uint64_t bound, const std::vector<SievingPrime>& primes,
+	uint8_t* sieve)
+{
+	std::fill(sieve, sieve + bytes, 0);
+	const uint64_t high = low + 30 * bytes;
+	for (const SievingPrime& sp : primes)
+	{
+		const uint64_t p = sp.prime;
+		if (p * p >= high)
 			break;
-	// }
 
-	//	std::cout << value << ',';
-	return true;
+		// 只需划掉 p * m（m >= p 且与 30 互素），同一余数类的倍数在位图中相隔 p 个字节
+		const uint64_t first = std::max(p, (low + p - 1) / p);
+		for (int k = 0; k < 8; ++k)
+		{
+			const uint64_t m = first + (RESIDUES[k] + 30 - first % 30) % 30;
+			const uint8_t mask = static_cast<uint8_t>(1u << sp.bits[k]);
+			for (uint64_t index = (p * m - low) / 30; index < bytes; index += p)
+				sieve[index] |= mask;
+		}
+	}
+
+	for (uint64_t index = 0; index < bytes; ++index)
+		sieve[index] = static_cast<uint8_t>(~sieve[index]);
+	// 1 不是素数
+	if (low == 0)
+		sieve[0] &= 0xFE;
+	// 清除超过 bound 的位
+	for (uint64_t index = bound < low ? 0 : (bound - low) / 30; index < bytes; ++index)
+	{
+		for (int k = 0; k < 8; ++k)
+		{
+			if (low + 30 * index + RESIDUES[k] > bound)
+				sieve[index] &= static_cast<uint8_t>(~(1u << k));
+		}
+	}
 }
 
-static void printPrimes() noexcept
+static bool printPrimes(uint64_t bound, const std::string& path, unsigned threads)
 {
-	static const int step[] = { 4, 2, 4, 2, 4, 6, 2, 6, };
-	int stepCount = sizeof(step) / sizeof(step[0]);
-
-	size_t primeSize = 0;
-	std::unique_ptr<uint32_t[]> primes(new uint32_t[203280218]);
-	//	std::vector<uint32_t> primes;
-	//	primes.reserve(105097561);
-	//	primes.reserve(203280218);
-	//	std::deque<uint32_t> primes;
-	int stepIndex = 0;//step_count - 1;
-	uint64_t i = 7;
-	while (i < std::numeric_limits<uint32_t>::max())
+	for (int k = 0; k < 8; ++k)
+		bitOfResidue[RESIDUES[k]] = static_cast<int8_t>(k);
+
+	uint32_t root = 1;
+	while (static_cast<uint64_t>(root + 1) * (root + 1) <= bound)
+		++root;
+	const std::vector<SievingPrime> primes = smallPrimes(root);
+
+	// 文件按最终大小映射，文件头最后写入；位图截断到覆盖 bound 的最后一个块
+	const uint64_t blockSpan = 30 * PrimeTable::BLOCK_BYTES;
+	const uint64_t bitmapBytes = (bound / blockSpan + 1) * PrimeTable::BLOCK_BYTES;
+	const uint64_t blockCount = bitmapBytes / PrimeTable::BLOCK_BYTES;
+	MapOptions options;
+	options.writable = true;
+	options.shared = true;
+	options.size = sizeof(PrimeTable::Header) + bitmapBytes + blockCount * sizeof(uint32_t);
+	options.hugePages = true;
+	MemoryMapFile file;
+	if (!file.open(FileNameType(path.begin(), path.end()), options))
 	{
-		if (isPrime(i, primes.get(), primeSize))
-			primes[primeSize++] = i;
+		std::cerr << "cannot open " << path << std::endl;
+		return false;
+	}
+	uint8_t* bitmap = static_cast<uint8_t*>(file.data()) + sizeof(PrimeTable::Header);
+	uint32_t* blockIndex = reinterpret_cast<uint32_t*>(bitmap + bitmapBytes);
 
-		i += step[stepIndex];
-		++stepIndex;
-		stepIndex %= stepCount;
+	const uint64_t segmentSpan = 30 * SEGMENT_BYTES;
+	const uint64_t segmentCount = bound / segmentSpan + 1;
+	std::atomic<uint64_t> nextSegment{ 0 };
+	std::vector<std::thread> workers;
+	for (unsigned t = 0; t < threads; ++t)
+	{
+		workers.emplace_back([&] {
+			for (uint64_t s = nextSegment++; s < segmentCount; s = nextSegment++)
+			{
+				const uint64_t offset = s * SEGMENT_BYTES;
+				sieveSegment(s * segmentSpan, std::min(SEGMENT_BYTES, bitmapBytes - offset), bound, primes, bitmap + offset);
+			}
+		});
 	}
+	for (std::thread& worker : workers)
+		worker.join();
 
-	/*	std::vector<uint32_t> primes2;
-		primes2.reserve(primes.size());
-		primes2.assign(primes.cbegin(), primes.cend());
-	*/	std::ofstream f("primes.dat", std::ios::binary);
-	f.write((const char*)primes.get(), primeSize * sizeof(uint32_t));
-	std::cout << "primes count: " << primeSize << std::endl;
-	/*
-		std::ofstream f("primes.txt");
-		for (auto v: primes)
-			f << v << ',' << std::endl;
-	*/
+	// 每块之前的素数个数
+	uint64_t total = 0;
+	for (uint64_t block = 0; block < blockCount; ++block)
+	{
+		blockIndex[block] = static_cast<uint32_t>(total);
+		for (uint64_t index = block * PrimeTable::BLOCK_BYTES; index < (block + 1) * PrimeTable::BLOCK_BYTES; ++index)
+			total += std::popcount(bitmap[index]);
+	}
+
+	PrimeTable::Header header{};
+	std::copy(std::begin(PrimeTable::MAGIC), std::end(PrimeTable::MAGIC), header.magic);
+	header.version = PrimeTable::VERSION;
+	header.blockBytes = PrimeTable::BLOCK_BYTES;
+	header.bound = bound;
+	header.count = total;
+	header.bitmapBytes = bitmapBytes;
+	header.checksum = PrimeTable::updateChecksum(0, bitmap, bitmapBytes + blockCount * sizeof(uint32_t));
+	std::memcpy(file.data(), &header, sizeof(header));
+
+	std::cout << "primes count: " << total << std::endl;
+	return file.flush();
 }
 
 int main(int argc, char* argv[])
 {
-	printPrimes();
-	return 0;
-};
+	const uint64_t bound = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : std::numeric_limits<uint32_t>::max();
+	const std::string path = argc > 2 ? argv[2] : "primes.dat";
+	const unsigned threads = argc > 3 ? static_cast<unsigned>(std::strtoul(argv[3], nullptr, 10))
+		: std::max(1u, std::thread::hardware_concurrency());
+	if (bound > std::numeric_limits<uint32_t>::max() || threads == 0)
+	{
+		std::cerr << "usage: print_primes [bound <= 4294967295] [output] [threads > 0]" << std::endl;
+		return 1;
+	}
+
+	return printPrimes(bound, path, threads) ? 0 : 1;
+}
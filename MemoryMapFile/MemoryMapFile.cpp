@@ -1,84 +1,244 @@
 ﻿#include "MemoryMapFile.h"
 
+#include <algorithm>
+#include <utility>
+
+MemoryMapFile::MemoryMapFile(MemoryMapFile&& other) noexcept {
+	*this = std::move(other);
+}
+
+MemoryMapFile& MemoryMapFile::operator=(MemoryMapFile&& other) noexcept {
+	if (this != &other) {
+		unLoad();
+#ifdef _WIN32
+		_file_handle = std::exchange(other._file_handle, INVALID_HANDLE_VALUE);
+		_map_handle = std::exchange(other._map_handle, HANDLE(NULL));
+#else
+		_file_handle = std::exchange(other._file_handle, -1);
+#endif
+		_map_address = std::exchange(other._map_address, nullptr);
+		_file_size = std::exchange(other._file_size, 0);
+		_locked = std::exchange(other._locked, false);
+	}
+	return *this;
+}
+
 void* MemoryMapFile::loadFile(const FileNameType& fileName, size_t& fileSize) {
+	if (!open(fileName)) {
+		return nullptr;
+	}
+	fileSize = _file_size;
+	return _map_address;
+}
+
+bool MemoryMapFile::open(const FileNameType& fileName, const MapOptions& options) {
+	unLoad();
+
 	#ifdef _WIN32
 	// 打开文件
-	_file_handle = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	_file_handle = CreateFileW(fileName.c_str(), options.writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+		FILE_SHARE_READ, NULL, options.writable ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
 	if (_file_handle == INVALID_HANDLE_VALUE) {
 		std::cerr << "Failed to open file on Windows." << std::endl;
-		return nullptr;
+		return false;
 	}
 
-	// 获取文件大小
-	LARGE_INTEGER getFileSize;
-	if (!GetFileSizeEx(_file_handle, &getFileSize)) {
+	// 获取或设置文件大小
+	LARGE_INTEGER fileSize;
+	if (options.writable && options.size != 0) {
+		fileSize.QuadPart = static_cast<LONGLONG>(options.size);
+		if (!SetFilePointerEx(_file_handle, fileSize, NULL, FILE_BEGIN) || !SetEndOfFile(_file_handle)) {
+			std::cerr << "Failed to resize file on Windows." << std::endl;
+			unLoad();
+			return false;
+		}
+	}
+	else if (!GetFileSizeEx(_file_handle, &fileSize)) {
 		std::cerr << "Failed to get file size on Windows." << std::endl;
-		CloseHandle(_file_handle);
-		return nullptr;
+		unLoad();
+		return false;
+	}
+	_file_size = static_cast<size_t>(fileSize.QuadPart);
+	if (_file_size == 0) {
+		std::cerr << "Cannot map an empty file." << std::endl;
+		unLoad();
+		return false;
 	}
-	fileSize = static_cast<size_t>(getFileSize.QuadPart);
 
-	// 创建文件映射对象
-	_map_handle = CreateFileMappingW(_file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	// 创建文件映射对象，私有的可写映射使用写时复制
+	const DWORD protect = !options.writable ? PAGE_READONLY : options.shared ? PAGE_READWRITE : PAGE_WRITECOPY;
+	_map_handle = CreateFileMappingW(_file_handle, NULL, protect, 0, 0, NULL);
 	if (_map_handle == NULL) {
 		std::cerr << "Failed to create file mapping on Windows." << std::endl;
-		CloseHandle(_file_handle);
-		return nullptr;
+		unLoad();
+		return false;
 	}
 
 	// 映射视图
-	void* mappedAddress = MapViewOfFile(_map_handle, FILE_MAP_READ, 0, 0, 0);
-	if (mappedAddress == NULL) {
+	const DWORD access = !options.writable ? FILE_MAP_READ : options.shared ? FILE_MAP_WRITE : FILE_MAP_COPY;
+	_map_address = MapViewOfFile(_map_handle, access, 0, 0, 0);
+	if (_map_address == NULL) {
 		std::cerr << "Failed to map view of file on Windows." << std::endl;
-		CloseHandle(_map_handle);
-		CloseHandle(_file_handle);
-		return nullptr;
+		unLoad();
+		return false;
 	}
 
-	return mappedAddress;
+	if (options.populate) {
+		advise(MapAdvice::WillNeed);
+	}
+	if (options.lock) {
+		_locked = VirtualLock(_map_address, _file_size) != 0;
+		if (!_locked) {
+			std::cerr << "Failed to lock mapped file on Windows." << std::endl;
+		}
+	}
 	#else
 	// 打开文件
 	// Linux 中 _file_handle 是 int 类型，直接接收 open 的返回值
-	_file_handle = open(fileName.c_str(), O_RDONLY);
+	_file_handle = ::open(fileName.c_str(), options.writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
 	if (_file_handle == -1) {
-		std::cerr << "Failed to open file on non-Windows." << std::endl;
-		return nullptr;
+		std::cerr << "Failed to open file on non-Windows: " << strerror(errno) << std::endl;
+		return false;
 	}
 
-	// 获取文件大小
-	fileSize = lseek(_file_handle, 0, SEEK_END);
-	lseek(_file_handle, 0, SEEK_SET);
+	// 获取或设置文件大小
+	if (options.writable && options.size != 0) {
+		if (ftruncate(_file_handle, static_cast<off_t>(options.size)) == -1) {
+			std::cerr << "Failed to resize file: " << strerror(errno) << std::endl;
+			unLoad();
+			return false;
+		}
+		_file_size = options.size;
+	}
+	else {
+		struct stat status;
+		if (fstat(_file_handle, &status) == -1) {
+			std::cerr << "Failed to get file size: " << strerror(errno) << std::endl;
+			unLoad();
+			return false;
+		}
+		_file_size = static_cast<size_t>(status.st_size);
+	}
+	if (_file_size == 0) {
+		std::cerr << "Cannot map an empty file." << std::endl;
+		unLoad();
+		return false;
+	}
 
 	// 内存映射
-	void* mappedAddress = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, _file_handle, 0);
+	const int protect = options.writable ? PROT_READ | PROT_WRITE : PROT_READ;
+	int flags = options.shared ? MAP_SHARED : MAP_PRIVATE;
+#ifdef MAP_POPULATE
+	if (options.populate) {
+		flags |= MAP_POPULATE;
+	}
+#endif
+	void* mappedAddress = mmap(NULL, _file_size, protect, flags, _file_handle, 0);
 	if (mappedAddress == MAP_FAILED) {
-		std::cerr << "Failed to map file on non-Windows." << std::endl;
-		close(_file_handle);
-		return nullptr;
+		std::cerr << "Failed to map file on non-Windows: " << strerror(errno) << std::endl;
+		unLoad();
+		return false;
 	}
+	_map_address = mappedAddress;
 
-	return mappedAddress;
+	// 提示只影响性能，失败时忽略
+#ifdef MADV_HUGEPAGE
+	if (options.hugePages) {
+		madvise(_map_address, _file_size, MADV_HUGEPAGE);
+	}
+#endif
+	if (options.advice != MapAdvice::Normal) {
+		advise(options.advice);
+	}
+	if (options.lock) {
+		_locked = mlock(_map_address, _file_size) == 0;
+		if (!_locked) {
+			std::cerr << "Failed to lock mapped file: " << strerror(errno) << std::endl;
+		}
+	}
+	#endif
+
+	return true;
+}
+
+bool MemoryMapFile::advise(MapAdvice advice, size_t offset, size_t length) const {
+	if (!_map_address || offset >= _file_size) {
+		return false;
+	}
+	length = std::min(length, _file_size - offset);
+
+	#ifdef _WIN32
+	if (advice != MapAdvice::WillNeed) {
+		return true;
+	}
+	WIN32_MEMORY_RANGE_ENTRY range = { static_cast<char*>(_map_address) + offset, length };
+	return PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0) != 0;
+	#else
+	// madvise 要求起始地址按页对齐
+	static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	const size_t aligned = offset / pageSize * pageSize;
+	int flag = MADV_NORMAL;
+	switch (advice) {
+	case MapAdvice::Sequential:
+		flag = MADV_SEQUENTIAL;
+		break;
+	case MapAdvice::Random:
+		flag = MADV_RANDOM;
+		break;
+	case MapAdvice::WillNeed:
+		flag = MADV_WILLNEED;
+		break;
+	default:
+		break;
+	}
+	return madvise(static_cast<char*>(_map_address) + aligned, length + offset - aligned, flag) == 0;
+	#endif
+}
+
+bool MemoryMapFile::flush() const {
+	if (!_map_address) {
+		return false;
+	}
+
+	#ifdef _WIN32
+	return FlushViewOfFile(_map_address, 0) != 0;
+	#else
+	return msync(_map_address, _file_size, MS_SYNC) == 0;
 	#endif
 }
 
 void MemoryMapFile::unLoad() {
 	#ifdef _WIN32
+	if (_map_address != NULL) {
+		if (_locked) {
+			VirtualUnlock(_map_address, _file_size);
+		}
+		UnmapViewOfFile(_map_address);
+	}
 	if (_map_handle != NULL) {
-		UnmapViewOfFile(_map_handle);
 		CloseHandle(_map_handle);
+		_map_handle = NULL;
 	}
 	if (_file_handle != INVALID_HANDLE_VALUE) {
 		CloseHandle(_file_handle);
+		_file_handle = INVALID_HANDLE_VALUE;
 	}
 	#else
-	 if (_file_handle != -1) {
-        // 使用保存的映射地址和文件大小解除映射
-        if (munmap(_map_address, _file_size) == -1) {
-            std::cerr << "Failed to unmap file: " << strerror(errno) << std::endl;
-        }
-        close(_file_handle);
-        _file_handle = -1;
-        _map_address = nullptr;
-    }
+	if (_map_address != nullptr) {
+		if (_locked) {
+			munlock(_map_address, _file_size);
+		}
+		// 使用保存的映射地址和文件大小解除映射
+		if (munmap(_map_address, _file_size) == -1) {
+			std::cerr << "Failed to unmap file: " << strerror(errno) << std::endl;
+		}
+	}
+	if (_file_handle != -1) {
+		close(_file_handle);
+		_file_handle = -1;
+	}
 	#endif
-}
\ No newline at end of file
+	_map_address = nullptr;
+	_file_size = 0;
+	_locked = false;
+}
@@ -19,6 +19,7 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <stdexcept>
 #include <algorithm>
 #include <compare>
@@ -31,42 +32,211 @@
 #include <limits>
 #include <ranges>
 #include <iomanip>
+#include <tuple>
+#include <charconv>
+#include <cstring>
+#include <concepts>
+#include <type_traits>
+#include <utility>
+#include <bit>
+#include <random>
+#include <chrono>
+#include <atomic>
+#include <thread>
 
+#include "LimbArena.h"
 #include "MemoryMapFile.h"
+#include "PrimeTable.h"
+#include "SmallVector.h"
+
+// 除 uint32_t、int64_t、uint64_t 以外的整数类型，由模板转发到这三种重载
+template <typename T>
+concept OtherIntegral = std::integral<T> && !std::same_as<T, bool>
+	&& !std::same_as<T, uint32_t> && !std::same_as<T, int64_t> && !std::same_as<T, uint64_t>;
+
+template <std::integral T>
+using Widened = std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>;
+
+class MontgomeryContext;
 
 class BIGINTEGER_DLL_API BigInteger {
 public:
 	// 从64位无符号整数构造
 	BigInteger(uint64_t num = 0);
 	// 比较运算符
-	auto operator<=>(const BigInteger& other) const;
+	std::strong_ordering operator<=>(const BigInteger& other) const;
 	bool operator==(const BigInteger& other) const;
-	bool operator==(int64_t other) const;
 	bool operator<(const BigInteger& other) const;
-	bool operator<(int64_t other) const;
 	bool operator<=(const BigInteger& other) const;
+	// 与原生整数比较，不构造临时 BigInteger
+	std::strong_ordering operator<=>(uint32_t other) const;
+	std::strong_ordering operator<=>(int64_t other) const;
+	std::strong_ordering operator<=>(uint64_t other) const;
+	bool operator==(uint32_t other) const;
+	bool operator==(int64_t other) const;
+	bool operator==(uint64_t other) const;
+	bool operator<(int64_t other) const;
+	template <OtherIntegral T>
+	std::strong_ordering operator<=>(T other) const { return *this <=> static_cast<Widened<T>>(other); }
+	template <OtherIntegral T>
+	bool operator==(T other) const { return *this == static_cast<Widened<T>>(other); }
 	// 一元运算符
 	BigInteger operator+() const;
-	BigInteger operator-() const;
-	// 算术运算符
-	BigInteger operator+(const BigInteger& other) const;
-	BigInteger operator-(const BigInteger& other) const;
+	BigInteger operator-() const&;
+	BigInteger operator-() &&;
+	// 复合赋值运算符，加减法原地完成
+	BigInteger& operator+=(const BigInteger& other);
+	BigInteger& operator-=(const BigInteger& other);
+	BigInteger& operator*=(const BigInteger& other);
+	BigInteger& operator/=(const BigInteger& other);
+	BigInteger& operator%=(const BigInteger& other);
+	// 原生整数操作数：加减乘单遍原地完成，除数不超过 32 位时除法和取模也是单遍
+	BigInteger& operator+=(uint32_t other);
+	BigInteger& operator+=(int64_t other);
+	BigInteger& operator+=(uint64_t other);
+	BigInteger& operator-=(uint32_t other);
+	BigInteger& operator-=(int64_t other);
+	BigInteger& operator-=(uint64_t other);
+	BigInteger& operator*=(uint32_t other);
+	BigInteger& operator*=(int64_t other);
+	BigInteger& operator*=(uint64_t other);
+	BigInteger& operator/=(uint32_t other);
+	BigInteger& operator/=(int64_t other);
+	BigInteger& operator/=(uint64_t other);
+	BigInteger& operator%=(uint32_t other);
+	BigInteger& operator%=(int64_t other);
+	BigInteger& operator%=(uint64_t other);
+	template <OtherIntegral T>
+	BigInteger& operator+=(T other) { return *this += static_cast<Widened<T>>(other); }
+	template <OtherIntegral T>
+	BigInteger& operator-=(T other) { return *this -= static_cast<Widened<T>>(other); }
+	template <OtherIntegral T>
+	BigInteger& operator*=(T other) { return *this *= static_cast<Widened<T>>(other); }
+	template <OtherIntegral T>
+	BigInteger& operator/=(T other) { return *this /= static_cast<Widened<T>>(other); }
+	template <OtherIntegral T>
+	BigInteger& operator%=(T other) { return *this %= static_cast<Widened<T>>(other); }
+	// 算术运算符，右值操作数的存储会被复用
+	BigInteger operator+(const BigInteger& other) const&;
+	BigInteger operator+(const BigInteger& other) &&;
+	BigInteger operator+(BigInteger&& other) const&;
+	BigInteger operator+(BigInteger&& other) &&;
+	BigInteger operator-(const BigInteger& other) const&;
+	BigInteger operator-(const BigInteger& other) &&;
+	BigInteger operator-(BigInteger&& other) const&;
+	BigInteger operator-(BigInteger&& other) &&;
 	BigInteger operator*(const BigInteger& other) const;
 	BigInteger operator/(const BigInteger& other) const;
 	BigInteger operator%(const BigInteger& other) const;
+	template <std::integral T>
+	BigInteger operator+(T other) const& { BigInteger result(*this); result += other; return result; }
+	template <std::integral T>
+	BigInteger operator+(T other) && { *this += other; return std::move(*this); }
+	template <std::integral T>
+	BigInteger operator-(T other) const& { BigInteger result(*this); result -= other; return result; }
+	template <std::integral T>
+	BigInteger operator-(T other) && { *this -= other; return std::move(*this); }
+	template <std::integral T>
+	BigInteger operator*(T other) const& { BigInteger result(*this); result *= other; return result; }
+	template <std::integral T>
+	BigInteger operator*(T other) && { *this *= other; return std::move(*this); }
+	template <std::integral T>
+	BigInteger operator/(T other) const { BigInteger result(*this); result /= other; return result; }
+	template <std::integral T>
+	BigInteger operator%(T other) const { BigInteger result(*this); result %= other; return result; }
+	// 除以 32 位整数，返回商和余数（余数与被除数同号），除数为零时抛出 std::invalid_argument
+	std::pair<BigInteger, int64_t> divmod(uint32_t divisor) const;
+	// |this| 对 32 位整数取模，只扫描一遍且不产生商
+	uint32_t mod(uint32_t divisor) const;
+	// 平方，利用对称性比一般乘法少算近一半的块乘积
+	BigInteger square() const;
+	// this^exponent mod modulus，结果在 [0, modulus) 内；模数与 10 互素时使用 Montgomery 乘法，否则每次乘法后取余。
+	// modulus 不为正数或 exponent 为负数时抛出 std::invalid_argument
+	BigInteger modPow(const BigInteger& exponent, const BigInteger& modulus) const;
+	// floor(sqrt(this))，this 为负数时抛出 std::invalid_argument
+	BigInteger isqrt() const;
+	// this 的 k 次方根，向零取整；k 为 0 或 k 为偶数而 this 为负数时抛出 std::invalid_argument
+	BigInteger iroot(uint32_t k) const;
+	// 是否为完全平方数，负数返回 false；先按几个小模数的二次剩余排除大部分非平方数
+	bool isPerfectSquare() const;
+	// this 模 modulus 的逆元，结果在 [0, modulus) 内；modulus 不为正数或与 this 不互素时抛出 std::invalid_argument
+	BigInteger modInverse(const BigInteger& modulus) const;
+	// 最大公约数，结果非负，gcd(0, 0) = 0。Lehmer 算法每步用最高两块的近似确定一串商，
+	// 很长的数先用半 GCD 递归约化高位，借助快速乘法达到次平方复杂度
+	static BigInteger gcd(const BigInteger& a, const BigInteger& b);
+	// 最小公倍数，结果非负，任一为 0 时为 0
+	static BigInteger lcm(const BigInteger& a, const BigInteger& b);
+	// 返回 (g, x, y)，g = gcd(a, b) = a * x + b * y；b 不为 0 时 |x| < |b| / g，b 为 0 时 x = sign(a)、y = 0
+	static std::tuple<BigInteger, BigInteger, BigInteger> extendedGcd(const BigInteger& a, const BigInteger& b);
+
+	// 转换为十进制字符串
+	std::string toString() const;
+	// 写入 [first, last)，不追加 '\0'；空间不足时返回 errc::value_too_large
+	std::to_chars_result toChars(char* first, char* last) const;
+	// 从十进制字符串解析，支持首位的正负号和数字之间的 ' 分隔符，格式错误时抛出 std::invalid_argument
+	static BigInteger fromChars(std::string_view str);
+
+	// 素性判定方式：Exhaustive 试除到平方根，结果是确定的；
+	// Probabilistic 只试除到 trialBound，之后做 Baillie-PSW 测试，并追加 extraRounds 轮随机底数的 Miller-Rabin 测试
+	enum class PrimalityMode { Exhaustive, Probabilistic };
+	struct PrimalityOptions {
+		PrimalityMode mode = PrimalityMode::Exhaustive;
+		uint32_t trialBound = 1u << 20;
+		int extraRounds = 0;
+		// 试除的线程数，0 表示使用全部硬件线程；自身不超过 uint64_t 时总是单线程
+		unsigned threads = 0;
+	};
 
 	bool isPrimeNumber() const;
 	bool isPrimeNumber(BigInteger& divisor) const noexcept;
+	// 试除阶段找到的因子写入 divisor；概率测试判定为合数时 divisor 不变
+	bool isPrimeNumber(BigInteger& divisor, const PrimalityOptions& options) const;
+	// 试除到 2^20 后做 Baillie-PSW 测试，目前没有已知的伪素数
+	bool isProbablePrime(int extraRounds = 0) const;
+
+	// 质因数分解的限制，单个合数因子在限制内没能分解时放弃
+	struct FactorOptions {
+		// 试除上界，先用素数表，超出表的部分用 mod 30 轮
+		uint32_t trialBound = 1u << 20;
+		// 每个合数因子 Pollard-Brent rho 的最多迭代次数
+		uint64_t rhoIterations = 1u << 20;
+		// 每个合数因子最多尝试的 ECM 曲线数，0 表示不限；B1 随曲线数从 2000 逐级增大到 3000000
+		int ecmCurves = 0;
+		// 总时间上限，0 表示不限；在两条曲线或两批 rho 迭代之间检查，可能略微超出
+		std::chrono::milliseconds timeLimit{ 0 };
+	};
+	// 分解 |this| 的质因数，从小到大排列并按重数重复，|this| < 2 时返回空。
+	// 超过试除上界的因子用 Baillie-PSW 判定素性；不加限制，难分解的数可能耗时很长
+	std::vector<BigInteger> factor() const;
+	// 在限制内没能分解的合数因子之积写入 cofactor，完全分解时为 1
+	std::vector<BigInteger> factor(const FactorOptions& options, BigInteger& cofactor) const;
+	// 斐波那契数 F(n)，快速倍增法，n 为负数时抛出 std::invalid_argument
 	static BigInteger fibonacci(int64_t n);
+	// 返回 (F(n), F(n+1))
+	static std::pair<BigInteger, BigInteger> fibonacciPair(int64_t n);
+	// 卢卡斯数 L(n)
+	static BigInteger lucas(int64_t n);
+	// 阶乘，按素数摆动分解 n! = ((n/2)!)^2 * swing(n)，大乘法都在规模相近的操作数之间进行
 	static BigInteger factorial(int64_t n);
+	// 不超过 n 的所有素数之积
+	static BigInteger primorial(int64_t n);
+	// a * (a+1) * ... * b，a > b 时为 1
+	static BigInteger rangeProduct(int64_t a, int64_t b);
 
 	// 友元声明
 	friend BIGINTEGER_DLL_API BigInteger operator"" _bi(const char* str, size_t len);
 	friend BIGINTEGER_DLL_API std::ostream& operator<<(std::ostream& os, const BigInteger& num);
+	friend BIGINTEGER_DLL_API std::istream& operator>>(std::istream& is, BigInteger& num);
+	friend class MontgomeryContext;
+	friend class BinaryInteger;
 
 private:
+	// 块数不超过 INLINE_LIMBS（约 2^128 以内）时存放在对象内部，不分配堆内存；更长的从线程局部的 LimbArena 分配
+	static constexpr size_t INLINE_LIMBS = 5;
+	using Digits = SmallVector<int32_t, INLINE_LIMBS, LimbAllocator<int32_t>>;
+
 	// 私有构造函数
-	BigInteger(std::vector<int32_t>&& d, bool negative)
+	BigInteger(Digits&& d, bool negative)
 		: digits(std::move(d)), isNegative(negative) {
 		removeLeadingZeros();
 		if (isZero()) {
@@ -77,14 +247,91 @@ private:
 	static bool allZero(const std::vector<uint64_t>& blocks);
 	int compareDigitsAbsolute(const BigInteger& other) const;
 	bool isZero() const;
+	// 十进制位数（不含符号）
+	size_t decimalSize() const;
 	void removeLeadingZeros();
+	// 取反，零保持非负
+	void negate();
+	// 取出 [from, from + count) 范围内的块组成新的非负整数
+	BigInteger slice(size_t from, size_t count) const;
+	// 乘以 BASE^count
+	BigInteger shiftedLeft(size_t count) const;
+	// 绝对值原地除以小整数，返回余数
+	uint32_t divSmallInPlace(uint32_t d);
 	int32_t mod3() const;
 	auto compareDigits(const BigInteger& other) const;
-	bool checkPrimeWithStep(BigInteger& divisor, BigInteger start) const;
-	BigInteger innerAdd(const BigInteger& other) const;
-	BigInteger innerSub(const BigInteger& other) const;
+	// 加载素数表，只在首次调用时读取一次文件，多线程同时调用也是安全的；失败时返回 false，之后不再重试
+	static bool loadPrimeTable();
+	// mod 30 轮上的候选数 value 对应的步长下标
+	static int wheelStepIndex(uint32_t value);
+	// 用 candidates[0, count) 试除并除尽，素因子追加到 factors；剩余部分为 1 或已证明为素数时返回 true
+	bool removeFactors(const uint32_t* candidates, size_t count, std::vector<BigInteger>& factors);
+	// 从 start 开始按 mod 30 轮试除不超过 bound 的候选数并除尽
+	bool removeWheelFactors(uint64_t start, int stepIndex, uint64_t bound, std::vector<BigInteger>& factors);
+	// 以下为最大公约数的内部实现，要求 a >= b >= 0。
+	// (a, b) -> (m00 a + m01 b, m10 a + m11 b) 的变换，行列式为 ±1，不改变最大公约数
+	struct GcdMatrix;
+	// 约化一步：用最高两块的近似做 Lehmer 约化，近似不足以确定商时做一次带余除法；
+	// matrix 非空时把这一步左乘到 matrix 上，cofactors 非空时同样变换 (cofactors[0], cofactors[1])
+	static void gcdStep(BigInteger& a, BigInteger& b, GcdMatrix* matrix, BigInteger* cofactors);
+	// 把 a、b 约化到 b 不超过 a 原块数的一半加一，返回所用的变换
+	static GcdMatrix halfGcd(BigInteger& a, BigInteger& b);
+	// 用 a、b 的高位部分计算的变换作用到 a、b 上，结果为负时取反并修正 matrix 相应的行，保持 a >= b
+	static void applyGcdMatrix(GcdMatrix& matrix, BigInteger& a, BigInteger& b);
+	// 约化到 b 为 0，返回 a；cofactors 非空时同样变换
+	static BigInteger gcdReduce(BigInteger a, BigInteger b, BigInteger* cofactors);
+	// 以下求合数 n 的一个非平凡因子，失败时返回 0，要求 n 与 10 互素
+	static BigInteger findFactor(const BigInteger& n, const FactorOptions& options, std::mt19937_64& engine,
+		std::chrono::steady_clock::time_point deadline);
+	static BigInteger pollardBrent(const BigInteger& n, uint64_t iterations, std::mt19937_64& engine,
+		std::chrono::steady_clock::time_point deadline);
+	// 用参数 sigma 确定的一条曲线做 ECM 阶段 1（上界 b1）和阶段 2（primes 中大于 b1 的素数）
+	static BigInteger ecmCurve(const MontgomeryContext& context, uint64_t sigma, uint32_t b1, const std::vector<uint32_t>& primes);
+	// 试除的结果：找到因子、已证明为素数（候选数超过平方根），或需要继续试除
+	enum class TrialResult { Divisible, Prime, Undecided };
+	// 以下 root 为 sqrtBound()，由调用方计算一次，候选数超过 root 时返回 Prime
+	// 从 start 开始按 mod 30 轮试除不超过 limit 的候选数
+	TrialResult checkPrimeWithStep(BigInteger& divisor, uint64_t start, int stepIndex, uint64_t limit, uint64_t root, unsigned threads = 1) const;
+	// 按从小到大的顺序用 candidates[0, count) 试除，每批候选数只遍历一次自身，找到的第一个因子写入 divisor
+	TrialResult trialDivide(const uint32_t* candidates, size_t count, BigInteger& divisor, uint64_t root) const;
+	// 用素数表的前 count 个素数试除，分段解码后调用 trialDivide
+	// threads > 1 且自身超过 uint64_t 时分段交给多个线程，结果与单线程相同
+	TrialResult trialDivideByTable(size_t count, BigInteger& divisor, uint64_t root, unsigned threads = 1) const;
+	// floor(sqrt(|this|))，超过 uint64_t 时为 uint64_t 的最大值
+	uint64_t sqrtBound() const;
+	// 第 chunk 段 candidates[0, count) 中第一个整除自身的数，没有时返回 0；
+	// 编号更小的段已找到因子（found < chunk）时提前返回 0
+	uint32_t firstDivisor(const uint32_t* candidates, size_t count, size_t chunk, const std::atomic<size_t>& found) const;
+	// |this| 不超过 uint64_t 时写入 value 并返回 true
+	bool fitsUint64(uint64_t& value) const;
+	// 比较 |this| 与 value，返回负数、零或正数
+	int compareAbsolute(uint64_t value) const;
+	// 绝对值原地相加；原地相减，|this| < |other| 时结果为 |other| - |this| 并返回 true
+	void addAbsolute(const BigInteger& other);
+	bool subAbsolute(const BigInteger& other);
+	void addAbsolute(uint64_t value);
+	bool subAbsolute(uint64_t value);
+	void mulAbsolute(uint64_t value);
 	BigInteger innerMul(const BigInteger& other) const;
+	BigInteger innerSqr() const;
+	static BigInteger toomCook3(const BigInteger& a, const BigInteger& b);
 	std::pair<BigInteger, BigInteger> innerDiv(const BigInteger& divisor) const;
+	std::pair<BigInteger, BigInteger> divKnuth(const BigInteger& divisor) const;
+	std::pair<BigInteger, BigInteger> divBurnikelZiegler(const BigInteger& divisor) const;
+	static std::pair<BigInteger, BigInteger> div2n1n(const BigInteger& a, const BigInteger& b, size_t n);
+	static std::pair<BigInteger, BigInteger> div3n2n(const BigInteger& a, const BigInteger& b, size_t half);
+	// |this| 的二进制表示，低位在前的 32 位字
+	std::vector<uint32_t> toBinaryWords() const;
+	// floor(|this|^(1/k))，从上方开始牛顿迭代；初值取浮点近似，较长的数取高位部分的根，
+	// 之后每步有效位数翻倍
+	BigInteger floorRoot(uint32_t k) const;
+	// 以下要求 this 大于 5 且与 10 互素
+	// 以 base 为底的强伪素数测试（Miller-Rabin）
+	bool isStrongProbablePrime(uint64_t base) const;
+	// Selfridge 参数的强卢卡斯伪素数测试
+	bool isStrongLucasProbablePrime() const;
+	// 返回 (F(k), F(k-1))，要求 k >= 1，每一位只做两次平方
+	static std::pair<BigInteger, BigInteger> fibonacciDoubling(uint64_t k);
 
 
 private:
@@ -92,14 +339,76 @@ private:
 	static const int STEP_COUNT;
 	static const int64_t BASE;
 	static const int DIGIT_WIDTH;
+	// 较短的操作数达到该块数时使用 Toom-Cook 3 路乘法
+	static const size_t TOOM3_THRESHOLD;
+	// 较短的操作数达到该块数时使用三素数 NTT 乘法
+	static const size_t NTT_THRESHOLD;
+	static const size_t NTT_SQR_THRESHOLD;
+	// 除数达到该块数、且被除数至少再长出 OFFSET 块时使用 Burnikel-Ziegler 递归除法
+	static const size_t BURNIKEL_ZIEGLER_THRESHOLD;
+	static const size_t BURNIKEL_ZIEGLER_OFFSET;
+	// 较短的数达到该块数时最大公约数使用半 GCD
+	static const size_t GCD_HALF_THRESHOLD;
+	// 试除时每批同时取模的候选数个数
+	static const size_t TRIAL_DIVISION_BATCH;
+	// 从素数表解码试除候选数时每段的最大个数，也是多线程试除时每段的候选数个数
+	static const size_t TRIAL_DIVISION_CHUNK;
 
-	std::vector<int32_t> digits;
+	Digits digits;
 	bool isNegative;
 	int digitCount;
 
-	static uint32_t* sPrimes;
-	static size_t primeCount;
-	static MemoryMapFile sMemFile;
+	static PrimeTable sPrimeTable;
+};
+
+// 原生整数在左侧的加法、减法和乘法
+template <std::integral T>
+BigInteger operator+(T lhs, const BigInteger& rhs) { return rhs + lhs; }
+template <std::integral T>
+BigInteger operator+(T lhs, BigInteger&& rhs) { return std::move(rhs) + lhs; }
+template <std::integral T>
+BigInteger operator-(T lhs, const BigInteger& rhs) { return -(rhs - lhs); }
+template <std::integral T>
+BigInteger operator*(T lhs, const BigInteger& rhs) { return rhs * lhs; }
+template <std::integral T>
+BigInteger operator*(T lhs, BigInteger&& rhs) { return std::move(rhs) * lhs; }
+
+// 固定模数 N 下的 Montgomery 乘法，R = BASE^n，n 为 N 的块数。约简只做逐块乘加而不做除法，
+// 适合同一模数下的大量乘法。块基数为 10^9，所以要求 N 与 10 互素
+class BIGINTEGER_DLL_API MontgomeryContext {
+public:
+	// 模数须大于 1 且与 10 互素，否则抛出 std::invalid_argument
+	explicit MontgomeryContext(const BigInteger& modulus);
+	static bool isSupported(const BigInteger& modulus);
+
+	const BigInteger& modulus() const { return mod; }
+	// R mod N，即 1 的 Montgomery 形式
+	const BigInteger& one() const { return rModN; }
+	// x * R mod N，x 可以是任意整数
+	BigInteger toMontgomery(const BigInteger& x) const;
+	// x * R^-1 mod N
+	BigInteger fromMontgomery(const BigInteger& x) const;
+	// a * b * R^-1 mod N，操作数须在 [0, N) 内
+	BigInteger multiply(const BigInteger& a, const BigInteger& b) const;
+	BigInteger square(const BigInteger& a) const;
+	// base^exponent mod N，输入输出都是普通形式，exponent 为负数时抛出 std::invalid_argument
+	BigInteger pow(const BigInteger& base, const BigInteger& exponent) const;
+
+private:
+	// 不超过该块数的乘积放在栈上
+	static constexpr size_t STACK_PRODUCT_LIMBS = 64;
+
+	// t * R^-1 mod N，要求 0 <= t < N * R
+	BigInteger reduce(BigInteger&& t) const;
+	// 同上，t 为 2n 块的数组
+	BigInteger reduce(const int32_t* t) const;
+
+	BigInteger mod;
+	size_t limbCount;
+	// -N^-1 mod BASE
+	uint32_t negInverse;
+	BigInteger rModN;
+	BigInteger rSquared;
 };
 
 class BIGINTEGER_DLL_API Matrix {
@@ -108,7 +417,7 @@ public:
 
 	Matrix();
 	Matrix operator*(const Matrix& other) const;
-	Matrix fastPower(int n) const;
+	Matrix fastPower(int64_t n) const;
 };
 
 // 全局声明添加宏
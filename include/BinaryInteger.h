@@ -0,0 +1,121 @@
+﻿#pragma once
+#include "BigInteger.h"
+
+// 以 2^32 为基数的任意精度整数，接口与 BigInteger 一致，另外提供移位、按位运算和位计数。
+// 块为 uint32_t，低位在前，按符号和绝对值存放；十进制只在输入输出时经 BigInteger 分治转换，
+// 适合移位、按位运算多或中间结果不需要打印的计算
+class BIGINTEGER_DLL_API BinaryInteger {
+public:
+	// 从64位无符号整数构造
+	BinaryInteger(uint64_t num = 0);
+	template <std::signed_integral T>
+	BinaryInteger(T num) : BinaryInteger(num < 0 ? 0 - static_cast<uint64_t>(num) : static_cast<uint64_t>(num)) {
+		isNegative = num < 0;
+	}
+	// 与 BigInteger 互相转换，长数分治进行
+	explicit BinaryInteger(const BigInteger& value);
+	BigInteger toBigInteger() const;
+
+	// 比较运算符
+	std::strong_ordering operator<=>(const BinaryInteger& other) const;
+	bool operator==(const BinaryInteger& other) const;
+	// 一元运算符，~x = -x - 1
+	BinaryInteger operator+() const;
+	BinaryInteger operator-() const;
+	BinaryInteger operator~() const;
+	// 复合赋值运算符；除法向零取整，余数与被除数同号，除数为零时抛出 std::invalid_argument
+	BinaryInteger& operator+=(const BinaryInteger& other);
+	BinaryInteger& operator-=(const BinaryInteger& other);
+	BinaryInteger& operator*=(const BinaryInteger& other);
+	BinaryInteger& operator/=(const BinaryInteger& other);
+	BinaryInteger& operator%=(const BinaryInteger& other);
+	// 按位运算按无限长的补码进行，负数的结果与原生有符号整数一致
+	BinaryInteger& operator&=(const BinaryInteger& other);
+	BinaryInteger& operator|=(const BinaryInteger& other);
+	BinaryInteger& operator^=(const BinaryInteger& other);
+	// 右移向负无穷取整，即补码的算术右移
+	BinaryInteger& operator<<=(size_t count);
+	BinaryInteger& operator>>=(size_t count);
+	// 算术运算符
+	BinaryInteger operator+(const BinaryInteger& other) const;
+	BinaryInteger operator-(const BinaryInteger& other) const;
+	BinaryInteger operator*(const BinaryInteger& other) const;
+	BinaryInteger operator/(const BinaryInteger& other) const;
+	BinaryInteger operator%(const BinaryInteger& other) const;
+	BinaryInteger operator&(const BinaryInteger& other) const;
+	BinaryInteger operator|(const BinaryInteger& other) const;
+	BinaryInteger operator^(const BinaryInteger& other) const;
+	BinaryInteger operator<<(size_t count) const;
+	BinaryInteger operator>>(size_t count) const;
+	// 平方，利用对称性比一般乘法少算近一半的块乘积
+	BinaryInteger square() const;
+	// this^exponent mod modulus，结果在 [0, modulus) 内；模数为奇数时使用 Montgomery 乘法，否则每次乘法后取余。
+	// modulus 不为正数或 exponent 为负数时抛出 std::invalid_argument
+	BinaryInteger modPow(const BinaryInteger& exponent, const BinaryInteger& modulus) const;
+
+	// |this| 的二进制位数，0 的位数为 0
+	size_t bitLength() const;
+	// 补码表示中第 index 位（最低位为第 0 位），负数的高位都为 1
+	bool testBit(size_t index) const;
+	// |this| 中 1 的个数
+	size_t popcount() const;
+
+	// 转换为十进制字符串
+	std::string toString() const;
+	// 写入 [first, last)，不追加 '\0'；空间不足时返回 errc::value_too_large
+	std::to_chars_result toChars(char* first, char* last) const;
+	// 从十进制字符串解析，格式与 BigInteger::fromChars 相同，格式错误时抛出 std::invalid_argument
+	static BinaryInteger fromChars(std::string_view str);
+
+	// 友元声明
+	friend BIGINTEGER_DLL_API std::ostream& operator<<(std::ostream& os, const BinaryInteger& num);
+	friend BIGINTEGER_DLL_API std::istream& operator>>(std::istream& is, BinaryInteger& num);
+
+private:
+	// 块数不超过 INLINE_LIMBS（2^128 以内）时存放在对象内部，不分配堆内存；更长的从线程局部的 LimbArena 分配
+	static constexpr size_t INLINE_LIMBS = 4;
+	using Limbs = SmallVector<uint32_t, INLINE_LIMBS, LimbAllocator<uint32_t>>;
+
+	BinaryInteger(Limbs&& l, bool negative)
+		: limbs(std::move(l)), isNegative(negative) {
+		removeLeadingZeros();
+	}
+	bool isZero() const;
+	// 去掉高位的 0，零值强制为非负
+	void removeLeadingZeros();
+	// 比较 |a| 与 |b|，返回负数、零或正数
+	static int compareAbsolute(const BinaryInteger& a, const BinaryInteger& b);
+	// 绝对值原地相加；原地相减，|this| < |other| 时结果为 |other| - |this|
+	void addAbsolute(const BinaryInteger& other);
+	void subAbsolute(const BinaryInteger& other);
+	// |this| 除以 |divisor| 的商和余数，都非负
+	std::pair<BinaryInteger, BinaryInteger> divideAbsolute(const BinaryInteger& divisor) const;
+	// 低 count 块的补码表示，count 须大于 |this| 的块数
+	Limbs toTwosComplement(size_t count) const;
+	// 按最高位的符号把补码还原为符号和绝对值
+	static BinaryInteger fromTwosComplement(Limbs&& words);
+	// 以下为进制转换的分治实现：长度不超过 RADIX_THRESHOLD 时逐块累加，
+	// 否则在不小于一半的 2 的幂处分成高低两部分，powers[j] 为 2^j 块对应的基数幂，按需平方生成
+	static BigInteger toDecimal(const uint32_t* a, size_t n, std::vector<BigInteger>& powers);
+	static BinaryInteger fromDecimal(const int32_t* d, size_t n, std::vector<BinaryInteger>& powers);
+
+	// 进制转换逐块累加的最大块数
+	static const size_t RADIX_THRESHOLD;
+
+	Limbs limbs;
+	bool isNegative = false;
+};
+
+// 原生整数在左侧的运算
+template <std::integral T>
+BinaryInteger operator+(T lhs, const BinaryInteger& rhs) { return BinaryInteger(lhs) + rhs; }
+template <std::integral T>
+BinaryInteger operator-(T lhs, const BinaryInteger& rhs) { return BinaryInteger(lhs) - rhs; }
+template <std::integral T>
+BinaryInteger operator*(T lhs, const BinaryInteger& rhs) { return BinaryInteger(lhs) * rhs; }
+template <std::integral T>
+BinaryInteger operator&(T lhs, const BinaryInteger& rhs) { return BinaryInteger(lhs) & rhs; }
+template <std::integral T>
+BinaryInteger operator|(T lhs, const BinaryInteger& rhs) { return BinaryInteger(lhs) | rhs; }
+template <std::integral T>
+BinaryInteger operator^(T lhs, const BinaryInteger& rhs) { return BinaryInteger(lhs) ^ rhs; }
@@ -0,0 +1,94 @@
+﻿#pragma once
+#ifdef _MSC_VER
+#ifdef BIGINTEGER_DLL_EXPORTS
+#define BIGINTEGER_DLL_API __declspec(dllexport)
+#else
+#define BIGINTEGER_DLL_API __declspec(dllimport)
+#endif
+#else
+#define BIGINTEGER_DLL_API
+#endif
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+// 线程局部的块缓冲池：释放的缓冲区按 2 的幂大小分级缓存在当前线程，之后同级的分配直接取用，
+// 不经过全局堆，也不与其他线程竞争。每级缓存的总量有上限，超出的部分以及大于 MAX_BYTES 的缓冲区
+// 直接交还全局堆；线程结束时释放全部缓存。一个线程分配、另一个线程释放的缓冲区进入释放方的缓存
+class BIGINTEGER_DLL_API LimbArena {
+public:
+	// 最小的大小级别，更小的分配按该大小取整
+	static constexpr size_t MIN_BYTES = 32;
+	// 最大的大小级别，更大的分配直接走全局堆
+	static constexpr size_t MAX_BYTES = size_t(1) << 20;
+	// 每级最多缓存的字节数，至少缓存 MIN_CACHED 个缓冲区
+	static constexpr size_t CACHED_BYTES_PER_CLASS = size_t(256) << 10;
+	static constexpr size_t MIN_CACHED = 4;
+
+	// 当前线程的统计
+	struct Stats {
+		// allocate 的调用次数
+		uint64_t allocations = 0;
+		// 其中经过全局堆的次数
+		uint64_t heapAllocations = 0;
+		// 当前缓存的字节数
+		size_t cachedBytes = 0;
+	};
+
+	static void* allocate(size_t bytes);
+	// bytes 须与 allocate 时相同
+	static void deallocate(void* p, size_t bytes) noexcept;
+	static Stats stats() noexcept;
+	// 把当前线程缓存的缓冲区全部交还全局堆
+	static void trim() noexcept;
+};
+
+// 经 LimbArena 分配的无状态分配器，用作 SmallVector 的分配器参数
+template <typename T>
+struct LimbAllocator {
+	using value_type = T;
+	using is_always_equal = std::true_type;
+
+	LimbAllocator() noexcept = default;
+	template <typename U>
+	LimbAllocator(const LimbAllocator<U>&) noexcept {}
+
+	T* allocate(size_t count) { return static_cast<T*>(LimbArena::allocate(count * sizeof(T))); }
+	void deallocate(T* p, size_t count) noexcept { LimbArena::deallocate(p, count * sizeof(T)); }
+
+	template <typename U>
+	bool operator==(const LimbAllocator<U>&) const noexcept { return true; }
+};
+
+// 线程局部的临时缓冲区，用于乘除法内核中只在一次调用内使用的中间结果。
+// 按栈的方式顺序分配，Scope 析构时归还它之后分配的全部空间；分段缓存在线程内复用，
+// 最外层 Scope 结束时交还大于 RETAINED_CHUNK_BYTES 的分段，避免一次大乘法之后长期占用内存
+class BIGINTEGER_DLL_API ScratchArena {
+public:
+	// 第一个分段的大小，之后每段加倍
+	static constexpr size_t INITIAL_CHUNK_BYTES = size_t(64) << 10;
+	static constexpr size_t RETAINED_CHUNK_BYTES = size_t(256) << 10;
+
+	class BIGINTEGER_DLL_API Scope {
+	public:
+		Scope() noexcept;
+		~Scope();
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		size_t _chunk;
+		size_t _used;
+	};
+
+	// 未初始化的 count 个 T，按 64 字节对齐，须在某个 Scope 内调用，Scope 结束后失效
+	template <typename T>
+	static T* allocate(size_t count) {
+		static_assert(std::is_trivially_copyable_v<T>, "ScratchArena 只用于可平凡复制的类型");
+		return static_cast<T*>(allocateBytes(count * sizeof(T)));
+	}
+
+private:
+	static void* allocateBytes(size_t bytes);
+};
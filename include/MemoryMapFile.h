@@ -10,44 +10,93 @@
 #endif
 
 #include <iostream>
-#include <fstream>
 #include <cstdint>
+#include <cstddef>
 #include <string>
-#include <fcntl.h>    // 包含 open、O_RDONLY 等
-#include <unistd.h>   // 包含 lseek、close 等
-#include <sys/mman.h> // 包含 mmap、munmap、PROT_READ、MAP_PRIVATE 等
-#include <sys/stat.h> // 辅助文件操作
-#include <cstring>  // 包含 strerror 声明
+#include <span>
 
-#if defined(__unix__)
-typedef std::string FileNameType;
-typedef int FileHandle;
-#define USTR(x) x
-#else
+#ifdef _WIN32
+#ifndef NOMINMAX
 #define NOMINMAX
+#endif
 #include <windows.h>
 #define __WIN
 typedef std::wstring FileNameType;
 typedef HANDLE FileHandle;
 #define USTR(x) L ## x
+#else
+#include <fcntl.h>    // 包含 open、O_RDONLY 等
+#include <unistd.h>   // 包含 lseek、close、ftruncate 等
+#include <sys/mman.h> // 包含 mmap、munmap、madvise、mlock 等
+#include <sys/stat.h> // 辅助文件操作
+#include <cstring>  // 包含 strerror 声明
+typedef std::string FileNameType;
+typedef int FileHandle;
+#define USTR(x) x
 #endif
 
+// 访问方式提示，对应 madvise；Windows 上只有 WillNeed 有效（PrefetchVirtualMemory）
+enum class MapAdvice { Normal, Sequential, Random, WillNeed };
+
+struct MapOptions {
+	// 可写映射；文件不存在时创建
+	bool writable = false;
+	// 写入是否同步到文件（MAP_SHARED），否则为写时复制的私有映射
+	bool shared = false;
+	// 可写映射时把文件截断或扩展到该大小，0 表示保持原大小
+	size_t size = 0;
+	// 映射时预先建立全部页表（MAP_POPULATE），避免之后逐页缺页
+	bool populate = false;
+	MapAdvice advice = MapAdvice::Normal;
+	// 建议使用透明大页（MADV_HUGEPAGE），减少大文件的 TLB 缺失
+	bool hugePages = false;
+	// 锁定在内存中（mlock），失败时只给出警告
+	bool lock = false;
+};
+
+// 文件的内存映射，析构时解除映射；只能移动，不能复制
 class MEMFILE_API MemoryMapFile {
 public:
-
+	MemoryMapFile() = default;
 	~MemoryMapFile() { unLoad(); }
+	MemoryMapFile(const MemoryMapFile&) = delete;
+	MemoryMapFile& operator=(const MemoryMapFile&) = delete;
+	MemoryMapFile(MemoryMapFile&& other) noexcept;
+	MemoryMapFile& operator=(MemoryMapFile&& other) noexcept;
 
+	// 映射文件，已有的映射先解除；失败时返回 false 并保持未映射状态
+	bool open(const FileNameType& fileName, const MapOptions& options = {});
+	// 只读映射整个文件，返回首地址，失败时返回 nullptr
 	void* loadFile(const FileNameType& fileName, size_t& fileSize);
 	void unLoad();
 
+	bool isOpen() const { return _map_address != nullptr; }
+	void* data() const { return _map_address; }
+	size_t size() const { return _file_size; }
+
+	// 按 T 的数组访问整个映射，末尾不足一个 T 的字节被忽略
+	template <typename T>
+	std::span<const T> view() const {
+		return { static_cast<const T*>(_map_address), _file_size / sizeof(T) };
+	}
+	template <typename T>
+	std::span<T> mutableView() const {
+		return { static_cast<T*>(_map_address), _file_size / sizeof(T) };
+	}
+
+	// 对 [offset, offset + length) 给出访问方式提示，length 超出映射时截到末尾
+	bool advise(MapAdvice advice, size_t offset = 0, size_t length = SIZE_MAX) const;
+	// 把共享映射中修改过的页写回文件
+	bool flush() const;
+
 private:
 #ifdef _WIN32
-	HANDLE _file_handle;
-    HANDLE _map_handle;       // Windows 特有：映射句柄
+	HANDLE _file_handle = INVALID_HANDLE_VALUE;
+	HANDLE _map_handle = NULL;       // Windows 特有：映射句柄
 #else
-	int _file_handle;    // Linux文件描述符
-    void* _map_address;  // Linux映射地址
-    size_t _file_size;   // Linux文件大小
+	int _file_handle = -1;    // Linux文件描述符
 #endif
+	void* _map_address = nullptr;
+	size_t _file_size = 0;
+	bool _locked = false;
 };
-
@@ -0,0 +1,130 @@
+﻿#pragma once
+#ifdef _MSC_VER
+#ifdef BIGINTEGER_DLL_EXPORTS
+#define BIGINTEGER_DLL_API __declspec(dllexport)
+#else
+#define BIGINTEGER_DLL_API __declspec(dllimport)
+#endif
+#else
+#define BIGINTEGER_DLL_API
+#endif
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <bit>
+
+#include "MemoryMapFile.h"
+
+// 2^32 以内从 7 开始的素数表（2、3、5 由调用方单独处理）。
+// 文件格式：Header 之后是 mod 30 轮的位图，第 i 字节表示 [30i, 30i + 30) 中与 30 互素的 8 个数，
+// 第 k 位对应余数 RESIDUES[k]，置位表示素数，2^32 以内约 143MB；位图之后每 BLOCK_BYTES 字节一项 uint32_t 索引，
+// 记录该块之前的素数个数，用于按下标随机访问。版本号或校验和不符的文件拒绝加载。
+// 没有文件头的 uint32_t 数组（旧格式）仍然可以加载
+class BIGINTEGER_DLL_API PrimeTable {
+public:
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t blockBytes;
+		// 表中包含 [7, bound] 内的全部素数
+		uint64_t bound;
+		uint64_t count;
+		// 位图的字节数，BLOCK_BYTES 的倍数
+		uint64_t bitmapBytes;
+		// 位图和索引的校验和
+		uint64_t checksum;
+		uint64_t reserved[2];
+	};
+	static constexpr char MAGIC[8] = { 'B', 'I', 'G', 'P', 'R', 'I', 'M', 'E' };
+	static constexpr uint32_t VERSION = 1;
+	static constexpr uint32_t BLOCK_BYTES = 64;
+	static constexpr uint32_t RESIDUES[8] = { 1, 7, 11, 13, 17, 19, 23, 29, };
+
+	// 按 8 字节一组累积校验和，分段计算时除最后一段外 size 须为 8 的倍数
+	static uint64_t updateChecksum(uint64_t hash, const void* data, size_t size) {
+		const auto* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; i += 8) {
+			uint64_t word = 0;
+			std::memcpy(&word, bytes + i, size - i < 8 ? size - i : 8);
+			hash = (hash ^ word) * 0x100000001B3ull;
+			hash ^= hash >> 32;
+		}
+		return hash;
+	}
+
+	// 按从小到大的顺序遍历
+	class Iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = uint32_t;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const uint32_t*;
+		using reference = uint32_t;
+
+		Iterator() = default;
+		uint32_t operator*() const {
+			if (table->legacy) {
+				return table->legacy[index];
+			}
+			return static_cast<uint32_t>(30 * byte + RESIDUES[std::countr_zero(bits)]);
+		}
+		Iterator& operator++() {
+			++index;
+			if (!table->legacy && index < table->count) {
+				bits &= bits - 1;
+				while (bits == 0) {
+					bits = table->bitmap[++byte];
+				}
+			}
+			return *this;
+		}
+		Iterator operator++(int) {
+			Iterator old = *this;
+			++*this;
+			return old;
+		}
+		bool operator==(const Iterator& other) const { return index == other.index; }
+
+	private:
+		friend class PrimeTable;
+		const PrimeTable* table = nullptr;
+		size_t index = 0;
+		// 位图中当前所在的字节，以及其中尚未遍历的素数位
+		size_t byte = 0;
+		uint8_t bits = 0;
+	};
+
+	// 加载文件，文件不存在、格式不对或校验和不符时返回 false。
+	// 加载时校验和会读遍整个文件，默认预先建立页表；试除按顺序扫描，并建议使用透明大页
+	bool load(const FileNameType& fileName,
+		const MapOptions& options = { .populate = true, .advice = MapAdvice::Sequential, .hugePages = true });
+	bool isLoaded() const { return count != 0; }
+
+	size_t size() const { return count; }
+	uint32_t back() const { return last; }
+	// 第 index 个素数，0 对应 7
+	uint32_t operator[](size_t index) const;
+	// value 是否为表中的素数
+	bool contains(uint32_t value) const;
+	// 表中不超过 value 的素数个数
+	size_t upperBound(uint32_t value) const;
+	// 从下标 index 开始解码最多 n 个素数写入 out，返回写入的个数
+	size_t decode(size_t index, size_t n, uint32_t* out) const;
+
+	Iterator begin() const { return iteratorAt(0); }
+	Iterator end() const;
+
+private:
+	Iterator iteratorAt(size_t index) const;
+
+	MemoryMapFile file;
+	// 旧格式的数组，为空时使用位图
+	const uint32_t* legacy = nullptr;
+	const uint8_t* bitmap = nullptr;
+	const uint32_t* blockIndex = nullptr;
+	size_t blockCount = 0;
+	size_t count = 0;
+	uint32_t last = 0;
+};
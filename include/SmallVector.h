@@ -0,0 +1,225 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+// 带内联存储的小向量：元素个数不超过 N 时直接存放在对象内部，不分配堆内存，
+// 超过后才转移到堆上。只支持可平凡复制的元素类型，接口是 std::vector 的子集。
+// 长度和容量用 uint32_t 保存以缩小对象体积。
+// 堆上的存储经 Allocator 分配；移动时直接接管指针，所以只支持无状态（is_always_equal）的分配器。
+template <typename T, size_t N, typename Allocator = std::allocator<T>>
+class SmallVector {
+	static_assert(std::is_trivially_copyable_v<T>, "SmallVector 只支持可平凡复制的类型");
+	static_assert(std::allocator_traits<Allocator>::is_always_equal::value, "SmallVector 只支持无状态的分配器");
+
+public:
+	using value_type = T;
+	using size_type = size_t;
+	using iterator = T*;
+	using const_iterator = const T*;
+	using reverse_iterator = std::reverse_iterator<T*>;
+	using const_reverse_iterator = std::reverse_iterator<const T*>;
+
+	SmallVector() noexcept : _data(_inline), _size(0), _capacity(N) {}
+
+	explicit SmallVector(size_t count) : SmallVector() {
+		resize(count);
+	}
+
+	SmallVector(size_t count, const T& value) : SmallVector() {
+		assign(count, value);
+	}
+
+	SmallVector(std::initializer_list<T> init) : SmallVector() {
+		assign(init.begin(), init.end());
+	}
+
+	SmallVector(const SmallVector& other) : SmallVector() {
+		assign(other.begin(), other.end());
+	}
+
+	SmallVector(SmallVector&& other) noexcept : SmallVector() {
+		moveFrom(other);
+	}
+
+	~SmallVector() {
+		release();
+	}
+
+	SmallVector& operator=(const SmallVector& other) {
+		if (this != &other) {
+			assign(other.begin(), other.end());
+		}
+
+		return *this;
+	}
+
+	SmallVector& operator=(SmallVector&& other) noexcept {
+		if (this != &other) {
+			release();
+			_data = _inline;
+			_size = 0;
+			_capacity = N;
+			moveFrom(other);
+		}
+
+		return *this;
+	}
+
+	SmallVector& operator=(std::initializer_list<T> init) {
+		assign(init.begin(), init.end());
+		return *this;
+	}
+
+	size_t size() const noexcept { return _size; }
+	size_t capacity() const noexcept { return _capacity; }
+	bool empty() const noexcept { return _size == 0; }
+	// 当前是否使用内联存储
+	bool isInline() const noexcept { return _data == _inline; }
+
+	T* data() noexcept { return _data; }
+	const T* data() const noexcept { return _data; }
+	T& operator[](size_t i) noexcept { return _data[i]; }
+	const T& operator[](size_t i) const noexcept { return _data[i]; }
+	T& front() noexcept { return _data[0]; }
+	const T& front() const noexcept { return _data[0]; }
+	T& back() noexcept { return _data[_size - 1]; }
+	const T& back() const noexcept { return _data[_size - 1]; }
+
+	iterator begin() noexcept { return _data; }
+	iterator end() noexcept { return _data + _size; }
+	const_iterator begin() const noexcept { return _data; }
+	const_iterator end() const noexcept { return _data + _size; }
+	reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+	reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+	const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+	const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+
+	void reserve(size_t count) {
+		if (count > _capacity) {
+			reallocate(count);
+		}
+	}
+
+	void clear() noexcept {
+		_size = 0;
+	}
+
+	void push_back(const T& value) {
+		if (_size == _capacity) {
+			T copy = value;	// value 可能引用自身的元素
+			reallocate(grownCapacity(_size + 1));
+			_data[_size++] = copy;
+			return;
+		}
+		_data[_size++] = value;
+	}
+
+	void pop_back() noexcept {
+		--_size;
+	}
+
+	// 新增的元素值初始化为 0
+	void resize(size_t count) {
+		resize(count, T());
+	}
+
+	void resize(size_t count, const T& value) {
+		if (count > _capacity) {
+			reallocate(std::max(count, grownCapacity(count)));
+		}
+		if (count > _size) {
+			std::fill(_data + _size, _data + count, value);
+		}
+		_size = static_cast<uint32_t>(count);
+	}
+
+	void assign(size_t count, const T& value) {
+		_size = 0;
+		resize(count, value);
+	}
+
+	template <std::input_iterator It>
+	void assign(It first, It last) {
+		const size_t count = static_cast<size_t>(std::distance(first, last));
+		if (count > _capacity) {
+			// first 可能指向自身，先分配新空间再复制
+			SmallVector tmp;
+			tmp.reallocate(count);
+			std::copy(first, last, tmp._data);
+			tmp._size = static_cast<uint32_t>(count);
+			*this = std::move(tmp);
+			return;
+		}
+		std::copy(first, last, _data);
+		_size = static_cast<uint32_t>(count);
+	}
+
+	iterator insert(const_iterator pos, size_t count, const T& value) {
+		const size_t index = static_cast<size_t>(pos - _data);
+		const T copy = value;
+		if (_size + count > _capacity) {
+			reallocate(grownCapacity(_size + count));
+		}
+		std::memmove(_data + index + count, _data + index, (_size - index) * sizeof(T));
+		std::fill(_data + index, _data + index + count, copy);
+		_size += static_cast<uint32_t>(count);
+		return _data + index;
+	}
+
+	iterator insert(const_iterator pos, const T& value) {
+		return insert(pos, 1, value);
+	}
+
+	bool operator==(const SmallVector& other) const noexcept {
+		return _size == other._size && std::equal(begin(), end(), other.begin());
+	}
+
+private:
+	size_t grownCapacity(size_t required) const noexcept {
+		return std::max(required, static_cast<size_t>(_capacity) * 2);
+	}
+
+	void reallocate(size_t capacity) {
+		T* data = std::allocator_traits<Allocator>::allocate(_allocator, capacity);
+		std::memcpy(data, _data, _size * sizeof(T));
+		release();
+		_data = data;
+		_capacity = static_cast<uint32_t>(capacity);
+	}
+
+	void release() noexcept {
+		if (_data != _inline) {
+			std::allocator_traits<Allocator>::deallocate(_allocator, _data, _capacity);
+		}
+	}
+
+	// 接管 other 的内容，要求 *this 当前为空的内联状态
+	void moveFrom(SmallVector& other) noexcept {
+		if (other._data == other._inline) {
+			std::memcpy(_inline, other._inline, other._size * sizeof(T));
+			_size = other._size;
+		}
+		else {
+			_data = other._data;
+			_size = other._size;
+			_capacity = other._capacity;
+			other._data = other._inline;
+			other._capacity = N;
+		}
+		other._size = 0;
+	}
+
+	T* _data;
+	uint32_t _size;
+	uint32_t _capacity;
+	[[no_unique_address]] Allocator _allocator;
+	T _inline[N];
+};